@@ -0,0 +1,28 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+
+void *yacdoc_alloc(const YacDocAllocator *allocator, size_t size) {
+    void *ptr = allocator != NULL ? allocator->alloc(allocator->ctx, size) : malloc(size);
+    assert(ptr != NULL);
+    return ptr;
+}
+
+void *yacdoc_realloc(const YacDocAllocator *allocator, void *ptr, size_t old_size, size_t new_size) {
+    ptr = allocator != NULL ? allocator->realloc(allocator->ctx, ptr, old_size, new_size) : realloc(ptr, new_size);
+    assert(ptr != NULL);
+    return ptr;
+}
+
+void yacdoc_free(const YacDocAllocator *allocator, void *ptr) {
+    if (allocator == NULL) {
+        free(ptr);
+    } else if (allocator->free != NULL) {
+        allocator->free(allocator->ctx, ptr);
+    }
+}
+
+bool yacdoc_allocator_frees_in_bulk(const YacDocAllocator *allocator) {
+    return allocator != NULL && allocator->free == NULL;
+}
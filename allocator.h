@@ -0,0 +1,26 @@
+#ifndef YACDOC_ALLOCATOR_H
+#define YACDOC_ALLOCATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Where maps, lists, values and the parsers get their memory. ctx is passed
+// back to every call. realloc is given the current size of the block, which
+// allocators that keep no headers need to copy it. An allocator whose free is
+// NULL releases everything at once, when its owner goes: containers built
+// from it skip walking their contents when freed, like arena containers do.
+// Wherever an allocator is taken, NULL stands for malloc, realloc and free.
+// The allocator must outlive every container made from it
+typedef struct {
+    void *(* alloc)(void *ctx, size_t size);
+    void *(* realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (* free)(void *ctx, void *ptr);
+    void *ctx;
+} YacDocAllocator;
+
+void *yacdoc_alloc(const YacDocAllocator *allocator, size_t size);
+void *yacdoc_realloc(const YacDocAllocator *allocator, void *ptr, size_t old_size, size_t new_size);
+void yacdoc_free(const YacDocAllocator *allocator, void *ptr);
+bool yacdoc_allocator_frees_in_bulk(const YacDocAllocator *allocator);
+
+#endif
@@ -0,0 +1,101 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define YACDOC_ARENA_BLOCK_SIZE (64 * 1024)
+#define YACDOC_ARENA_ALIGNMENT (2 * sizeof(void *))
+
+static size_t yacdoc_arena_align(size_t size) {
+    return (size + YACDOC_ARENA_ALIGNMENT - 1) & ~(YACDOC_ARENA_ALIGNMENT - 1);
+}
+
+static YacDocArenaBlock *yacdoc_arena_block_new(size_t capacity) {
+    YacDocArenaBlock *block = malloc(sizeof(YacDocArenaBlock) + capacity);
+    assert(block != NULL);
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+static void *yacdoc_arena_allocator_alloc(void *ctx, size_t size) {
+    return yacdoc_arena_alloc(ctx, size);
+}
+
+static void *yacdoc_arena_allocator_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    return yacdoc_arena_realloc(ctx, ptr, old_size, new_size);
+}
+
+YacDocArena *yacdoc_arena_new() {
+    YacDocArena *arena = malloc(sizeof(YacDocArena));
+    assert(arena != NULL);
+    arena->head = yacdoc_arena_block_new(YACDOC_ARENA_BLOCK_SIZE);
+    arena->last = NULL;
+    arena->allocator.alloc = yacdoc_arena_allocator_alloc;
+    arena->allocator.realloc = yacdoc_arena_allocator_realloc;
+    arena->allocator.free = NULL;
+    arena->allocator.ctx = arena;
+    return arena;
+}
+
+void yacdoc_arena_free(YacDocArena *arena) {
+    YacDocArenaBlock *block = arena->head;
+    while (block != NULL) {
+        YacDocArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void *yacdoc_arena_alloc(YacDocArena *arena, size_t size) {
+    size = yacdoc_arena_align(size);
+    YacDocArenaBlock *block = arena->head;
+    if (block->capacity - block->used < size) {
+        if (size > YACDOC_ARENA_BLOCK_SIZE / 4) {
+            // Oversized requests get a block of their own behind the current one
+            YacDocArenaBlock *large = yacdoc_arena_block_new(size);
+            large->next = block->next;
+            block->next = large;
+            large->used = size;
+            return large->data;
+        }
+        block = yacdoc_arena_block_new(YACDOC_ARENA_BLOCK_SIZE);
+        block->next = arena->head;
+        arena->head = block;
+    }
+    void *ptr = block->data + block->used;
+    block->used += size;
+    arena->last = ptr;
+    return ptr;
+}
+
+void *yacdoc_arena_realloc(YacDocArena *arena, void *ptr, size_t old_size, size_t new_size) {
+    YacDocArenaBlock *block = arena->head;
+    if (ptr != NULL && ptr == arena->last) {
+        // Resize the most recent allocation in place when the block has room
+        size_t offset = (char *) ptr - block->data;
+        if (offset + yacdoc_arena_align(new_size) <= block->capacity) {
+            block->used = offset + yacdoc_arena_align(new_size);
+            return ptr;
+        }
+    }
+    // Any other block can shrink where it is, its tail is only left unused
+    if (ptr != NULL && new_size <= old_size) return ptr;
+    void *new_ptr = yacdoc_arena_alloc(arena, new_size);
+    if (ptr != NULL) memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    return new_ptr;
+}
+
+char *yacdoc_arena_strndup(YacDocArena *arena, const char *str, size_t len) {
+    char *copy = yacdoc_arena_alloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+const YacDocAllocator *yacdoc_arena_allocator(YacDocArena *arena) {
+    return &arena->allocator;
+}
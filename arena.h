@@ -0,0 +1,30 @@
+#ifndef YACDOC_ARENA_H
+#define YACDOC_ARENA_H
+
+#include <stddef.h>
+
+#include "allocator.h"
+
+typedef struct YacDocArenaBlock {
+    struct YacDocArenaBlock *next;
+    size_t capacity;
+    size_t used;
+    char data[];
+} YacDocArenaBlock;
+
+// allocator hands out memory from the arena to containers and parsers that
+// take an allocator; its free is NULL, as arena memory goes all at once
+typedef struct {
+    YacDocArenaBlock *head;
+    void *last;
+    YacDocAllocator allocator;
+} YacDocArena;
+
+YacDocArena *yacdoc_arena_new();
+void yacdoc_arena_free(YacDocArena *arena);
+void *yacdoc_arena_alloc(YacDocArena *arena, size_t size);
+void *yacdoc_arena_realloc(YacDocArena *arena, void *ptr, size_t old_size, size_t new_size);
+char *yacdoc_arena_strndup(YacDocArena *arena, const char *str, size_t len);
+const YacDocAllocator *yacdoc_arena_allocator(YacDocArena *arena);
+
+#endif
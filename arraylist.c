@@ -1,73 +1,98 @@
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
 
 #include "arraylist.h"
 
-#define YACDOC_ARRAYLIST_INITIAL_CAPACITY (64)
+#define YACDOC_ARRAYLIST_INITIAL_CAPACITY (4)
 
 YacDocArrayList *yacdoc_arraylist_new() {
-    YacDocArrayList *list = malloc(sizeof(YacDocArrayList));
-    assert(list != NULL);
-    list->capacity = YACDOC_ARRAYLIST_INITIAL_CAPACITY;
+    return yacdoc_arraylist_new_with(NULL);
+}
+
+// The list and its item array come from allocator; lists of an allocator
+// that frees in bulk, like an arena's, are released together with it. The
+// item array is allocated on the first add
+YacDocArrayList *yacdoc_arraylist_new_with(const YacDocAllocator *allocator) {
+    YacDocArrayList *list = yacdoc_alloc(allocator, sizeof(YacDocArrayList));
+    list->capacity = 0;
     list->size = 0;
-    list->items = calloc(list->capacity, sizeof(YacDocArrayListItem *));
-    assert(list->items != NULL);
+    list->items = NULL;
+    list->allocator = allocator;
+    list->packed_kind = 0;
+    list->packed = NULL;
+    list->cache = NULL;
     return list;
 }
 
 void yacdoc_arraylist_free(YacDocArrayList *list, YacDocArrayListValueFreeFunc free_func) {
-    for (int i = 0; i < list->capacity; i++) {
-        if (list->items[i] == NULL) continue;
-        free_func(list->items[i]->value);
-        free(list->items[i]);
+    if (yacdoc_allocator_frees_in_bulk(list->allocator)) return;
+    if (list->packed_kind == 0) {
+        for (int i = 0; i < list->size; i++) free_func(list->items[i].value, list->allocator);
+    }
+    yacdoc_free(list->allocator, list->packed);
+    yacdoc_free(list->allocator, list->items);
+    yacdoc_free(list->allocator, list);
+}
+
+static void yacdoc_arraylist_set_capacity(YacDocArrayList *list, int capacity) {
+    size_t old_size = list->capacity * sizeof(YacDocArrayListItem);
+    size_t new_size = capacity * sizeof(YacDocArrayListItem);
+    if (capacity == 0) {
+        yacdoc_free(list->allocator, list->items);
+        list->items = NULL;
+    } else {
+        list->items = yacdoc_realloc(list->allocator, list->items, old_size, new_size);
     }
-    free(list);
+    list->capacity = capacity;
+}
+
+// Makes room for at least capacity items, so that a known number of adds
+// reallocates once at most
+void yacdoc_arraylist_reserve(YacDocArrayList *list, int capacity) {
+    if (capacity > list->capacity) yacdoc_arraylist_set_capacity(list, capacity);
+}
+
+// Gives back the room past the last item. Lists in an arena can only return
+// it while their item array is the arena's latest allocation
+void yacdoc_arraylist_shrink_to_fit(YacDocArrayList *list) {
+    if (list->size < list->capacity) yacdoc_arraylist_set_capacity(list, list->size);
 }
 
-static void yacdoc_list_resize(YacDocArrayList *list) {
-    list->capacity *= 2;
-    list->items = realloc(list->items, list->capacity * sizeof(YacDocArrayListItem *));
-    assert(list->items != NULL);
+// Lists start small and double, so the many short arrays of a document stay
+// small while long ones reallocate a logarithmic number of times
+static void yacdoc_arraylist_grow(YacDocArrayList *list, int count) {
+    int capacity = list->capacity == 0 ? YACDOC_ARRAYLIST_INITIAL_CAPACITY : list->capacity * 2;
+    while (capacity < list->size + count) capacity *= 2;
+    yacdoc_arraylist_set_capacity(list, capacity);
 }
 
 void yacdoc_arraylist_add(YacDocArrayList *list, void *value) {
-    if (list->size == list->capacity) {
-        yacdoc_list_resize(list);
-    }
-    YacDocArrayListItem *item = malloc(sizeof(YacDocArrayListItem));
-    assert(item != NULL);
-    item->value = value;
-    list->items[list->size] = item;
-    list->size++;
+    if (list->size == list->capacity) yacdoc_arraylist_grow(list, 1);
+    list->items[list->size++].value = value;
+}
+
+void yacdoc_arraylist_add_all(YacDocArrayList *list, void *const *values, int count) {
+    if (list->size + count > list->capacity) yacdoc_arraylist_grow(list, count);
+    for (int i = 0; i < count; i++) list->items[list->size + i].value = values[i];
+    list->size += count;
 }
 
 void *yacdoc_arraylist_get(YacDocArrayList *list, int index) {
-    if (list->items[index] != NULL) {
-        return list->items[index]->value;    
-    }
+    if (index >= 0 && index < list->size) return list->items[index].value;
     return NULL;
 }
 
-YacDocArrayListIterator *yacdoc_arraylist_iterator_new(YacDocArrayList *list) {
-    YacDocArrayListIterator *it = malloc(sizeof(YacDocArrayListIterator));
-    assert(it != NULL);
+// Iterators live wherever the caller puts them, usually on its stack, and
+// need no freeing
+void yacdoc_arraylist_iterator_init(YacDocArrayListIterator *it, YacDocArrayList *list) {
     it->count = 0;
-    it->last = -1;
     it->list = list;
-    return it;
-}
-
-void yacdoc_arraylist_iterator_free(YacDocArrayListIterator *it) {
-    free(it);
 }
 
 YacDocArrayListItem *yacdoc_arraylist_iterator_next(YacDocArrayListIterator *it) {
-    if (it->last == it->list->size - 1) {
-        return NULL;
-    }
-    it->count++;
-    it->last++;
-    return it->list->items[it->last];
+    if (it->count >= it->list->size) return NULL;
+    return &it->list->items[it->count++];
 }
 
 int yacdoc_arraylist_iterator_count(YacDocArrayListIterator *it) {
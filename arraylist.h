@@ -3,30 +3,45 @@
 
 #include <stdbool.h>
 
+#include "allocator.h"
+
 typedef struct {
     void *value;
 } YacDocArrayListItem;
 
+// Values are held inline in items, which moves when the list grows. A list
+// whose packed_kind is nonzero keeps its elements unboxed in packed, in
+// a layout only its owner knows; items is unused and size and capacity count
+// those elements. The owner must unpack it before using the functions below
+// other than yacdoc_arraylist_free. cache is left to the owner as well, NULL
+// until it sets it
 typedef struct {
     int capacity;
     int size;
-    YacDocArrayListItem **items;
+    YacDocArrayListItem *items;
+    const YacDocAllocator *allocator;
+    int packed_kind;
+    void *packed;
+    void *cache;
 } YacDocArrayList;
 
 typedef struct {
     int count;
-    int last;
     YacDocArrayList *list;
 } YacDocArrayListIterator;
 
-typedef void (* YacDocArrayListValueFreeFunc)(void *);
+// Called on each value with the list's allocator, for values taken from it
+typedef void (* YacDocArrayListValueFreeFunc)(void *value, const YacDocAllocator *allocator);
 
 YacDocArrayList *yacdoc_arraylist_new();
+YacDocArrayList *yacdoc_arraylist_new_with(const YacDocAllocator *allocator);
 void yacdoc_arraylist_free(YacDocArrayList *list, YacDocArrayListValueFreeFunc free_func);
+void yacdoc_arraylist_reserve(YacDocArrayList *list, int capacity);
+void yacdoc_arraylist_shrink_to_fit(YacDocArrayList *list);
 void yacdoc_arraylist_add(YacDocArrayList *list, void *value);
+void yacdoc_arraylist_add_all(YacDocArrayList *list, void *const *values, int count);
 void *yacdoc_arraylist_get(YacDocArrayList *list, int index);
-YacDocArrayListIterator *yacdoc_arraylist_iterator_new(YacDocArrayList *list);
-void yacdoc_arraylist_iterator_free(YacDocArrayListIterator *it);
+void yacdoc_arraylist_iterator_init(YacDocArrayListIterator *it, YacDocArrayList *list);
 YacDocArrayListItem *yacdoc_arraylist_iterator_next(YacDocArrayListIterator *it);
 int yacdoc_arraylist_iterator_count(YacDocArrayListIterator *it);
 
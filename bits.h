@@ -0,0 +1,21 @@
+#ifndef YACDOC_BITS_H
+#define YACDOC_BITS_H
+
+#include <stdint.h>
+
+// Index of the lowest set bit; bits must not be zero. For the tokenizer, the
+// validator and the hash map probes, which all walk bit masks
+static inline int yacdoc_trailing_zeros(uint64_t bits) {
+#ifdef __GNUC__
+    return __builtin_ctzll(bits);
+#else
+    int count = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+#endif
@@ -1,120 +1,385 @@
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define YACDOC_HASHMAP_X86
+#include <immintrin.h>
+#endif
+
+#include "bits.h"
 #include "hashmap.h"
 
-#define YACDOC_HASHMAP_INITIAL_CAPACITY (64)
+#define YACDOC_HASHMAP_FLAT_INITIAL_CAPACITY (4)
+#define YACDOC_HASHMAP_MAX_FLAT_SIZE (8)
+#define YACDOC_HASHMAP_INITIAL_CAPACITY (32)
+#define YACDOC_HASHMAP_GROUP_SIZE (16)
+#define YACDOC_HASHMAP_EMPTY (0x80)
+#define YACDOC_KEY_TABLE_INITIAL_CAPACITY (64)
 
 YacDocHashMap *yacdoc_hashmap_new() {
-    YacDocHashMap *map = malloc(sizeof(YacDocHashMap));
-    assert(map != NULL);
-    map->capacity = YACDOC_HASHMAP_INITIAL_CAPACITY;
+    return yacdoc_hashmap_new_with(NULL);
+}
+
+// Maps take every item, key and index from allocator; those of an allocator
+// that frees in bulk, like an arena's, are released together with it. Nothing
+// is allocated for the items until the first add
+YacDocHashMap *yacdoc_hashmap_new_with(const YacDocAllocator *allocator) {
+    YacDocHashMap *map = yacdoc_alloc(allocator, sizeof(YacDocHashMap));
+    map->capacity = 0;
     map->size = 0;
-    map->items = calloc(map->capacity, sizeof(YacDocHashMapItem *));
-    assert(map->items != NULL);
+    map->items = NULL;
+    map->allocator = allocator;
+    map->cache = NULL;
+    memset(map->tags, YACDOC_HASHMAP_EMPTY, sizeof(map->tags));
     return map;
 }
 
+static bool yacdoc_hashmap_is_flat(YacDocHashMap *map) {
+    return map->capacity <= YACDOC_HASHMAP_MAX_FLAT_SIZE;
+}
+
+// Number of items a map of the given capacity has room for: all of them while
+// it is flat, seven eighths of the index slots once it is hashed
+static int yacdoc_hashmap_item_capacity(int capacity) {
+    return capacity <= YACDOC_HASHMAP_MAX_FLAT_SIZE ? capacity : capacity / 8 * 7;
+}
+
+// A hashed map allocates one block holding a control byte per index slot, then
+// the item number each slot points to, then the items. Flat maps allocate the
+// items alone and keep their control bytes in tags
+static size_t yacdoc_hashmap_index_size(int capacity) {
+    return capacity <= YACDOC_HASHMAP_MAX_FLAT_SIZE ? 0 : capacity * (1 + sizeof(int32_t));
+}
+
+static size_t yacdoc_hashmap_block_size(int capacity) {
+    return yacdoc_hashmap_index_size(capacity) + yacdoc_hashmap_item_capacity(capacity) * sizeof(YacDocHashMapItem);
+}
+
+static void *yacdoc_hashmap_block(YacDocHashMap *map) {
+    return (char *) map->items - yacdoc_hashmap_index_size(map->capacity);
+}
+
+static uint8_t *yacdoc_hashmap_ctrl(YacDocHashMap *map) {
+    return yacdoc_hashmap_block(map);
+}
+
+static int32_t *yacdoc_hashmap_slots(YacDocHashMap *map) {
+    return (int32_t *) (yacdoc_hashmap_ctrl(map) + map->capacity);
+}
+
+static YacDocHashMapKey *yacdoc_hashmap_key(const char *key) {
+    return (YacDocHashMapKey *) (key - offsetof(YacDocHashMapKey, data));
+}
+
+static YacDocHashMapKey *yacdoc_hashmap_key_new(const YacDocAllocator *allocator, const char *key, size_t len, uint64_t hash) {
+    YacDocHashMapKey *header = yacdoc_alloc(allocator, sizeof(YacDocHashMapKey) + len + 1);
+    header->hash = hash;
+    header->refs = 1;
+    memcpy(header->data, key, len);
+    header->data[len] = '\0';
+    return header;
+}
+
+static void yacdoc_hashmap_key_release(const YacDocAllocator *allocator, YacDocHashMapKey *key) {
+    if (--key->refs == 0) yacdoc_free(allocator, key);
+}
+
 void yacdoc_hashmap_free(YacDocHashMap *map, YacDocHashMapValueFreeFunc free_func) {
+    if (yacdoc_allocator_frees_in_bulk(map->allocator)) return;
     for (int i = 0; i < map->size; i++) {
-        if (map->items[i] == NULL) continue;
-        free(map->items[i]->key);
-        free_func(map->items[i]->value);
-        free(map->items[i]);
+        yacdoc_hashmap_key_release(map->allocator, yacdoc_hashmap_key(map->items[i].key));
+        free_func(map->items[i].value, map->allocator);
     }
-    free(map->items);
-    free(map);
+    if (map->items != NULL) yacdoc_free(map->allocator, yacdoc_hashmap_block(map));
+    yacdoc_free(map->allocator, map);
+}
+
+// djb2 widened to 64 bits. For the short keys documents have, one pass over
+// the bytes costs less than finding their length to hash them a word at a time
+static uint64_t yacdoc_hash_step(uint64_t hash, char ch) {
+    return ((hash << 5) + hash) + (unsigned char) ch;
+}
+
+// The multiply spreads the state upwards and the shift folds it back into the
+// low bits, which the tags and the groups are taken from
+static uint64_t yacdoc_hash_finish(uint64_t hash) {
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 32);
+}
+
+static uint64_t yacdoc_hash_bytes(const char *data, size_t len) {
+    uint64_t hash = 5381;
+    for (size_t i = 0; i < len; i++) hash = yacdoc_hash_step(hash, data[i]);
+    return yacdoc_hash_finish(hash);
+}
+
+// The low seven bits are kept in the control byte of the item's index slot,
+// the rest pick the group where probing starts
+static uint8_t yacdoc_hashmap_tag(uint64_t hash) {
+    return hash & 0x7F;
 }
 
-static int yacdoc_positive_mod(int value, int mod) {
-    return (value % mod + mod) % mod;
+static bool yacdoc_hashmap_key_equals(const char *item_key, const char *key, uint64_t hash) {
+    return item_key == key || (yacdoc_hashmap_key(item_key)->hash == hash && !strcmp(item_key, key));
 }
 
-static int yacdoc_djb2_hash(const char *str) {
-    int hash = 5381;
-    char *ch_ptr = (char *) str;
-    while (*ch_ptr != '\0') {
-        hash = ((hash << 5) + hash) + *ch_ptr;
-        ch_ptr++;
+// One bit per control byte of the group that equals tag
+static unsigned yacdoc_hashmap_group_match(const uint8_t *ctrl, uint8_t tag) {
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < YACDOC_HASHMAP_GROUP_SIZE; i++) {
+        if (ctrl[i] == tag) mask |= 1u << i;
     }
-    return hash;
+    return mask;
+#endif
 }
 
-static void yacdoc_hashmap_resize(YacDocHashMap *map) {
-    YacDocHashMapItem **old_items = map->items;
-    map->capacity *= 2;
-    map->items = calloc(map->capacity, sizeof(YacDocHashMap *));
-    assert(map->items != NULL);
+static unsigned yacdoc_hashmap_group_empty(const uint8_t *ctrl) {
+#ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) ctrl));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < YACDOC_HASHMAP_GROUP_SIZE; i++) {
+        if (ctrl[i] & YACDOC_HASHMAP_EMPTY) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+// The eight control bytes of a flat map compared with tag in one word. The
+// high bit of each matching byte is set; a byte right above a match may be
+// flagged too, which the key comparison sorts out
+static uint64_t yacdoc_hashmap_flat_match(const uint8_t *ctrl, uint8_t tag) {
+    uint64_t word;
+    memcpy(&word, ctrl, 8);
+    word ^= 0x0101010101010101ULL * tag;
+    return (word - 0x0101010101010101ULL) & ~word & 0x8080808080808080ULL;
+}
+
+static int yacdoc_hashmap_probe_start(YacDocHashMap *map, uint64_t hash) {
+    return (int) ((hash >> 7) & (uint64_t) (map->capacity / YACDOC_HASHMAP_GROUP_SIZE - 1));
+}
+
+// Index slot of key in a hashed map, or the first empty slot along its probe
+// sequence, where it would go. Groups are visited in triangular steps, which
+// on a power of two number of groups reaches each of them once
+static int yacdoc_hashmap_probe(YacDocHashMap *map, const char *key, uint64_t hash) {
+    const uint8_t *ctrl = yacdoc_hashmap_ctrl(map);
+    const int32_t *slots = yacdoc_hashmap_slots(map);
+    int group_mask = map->capacity / YACDOC_HASHMAP_GROUP_SIZE - 1;
+    int group = yacdoc_hashmap_probe_start(map, hash);
+    uint8_t tag = yacdoc_hashmap_tag(hash);
+    for (int step = 1;; step++) {
+        int first = group * YACDOC_HASHMAP_GROUP_SIZE;
+        for (unsigned match = yacdoc_hashmap_group_match(ctrl + first, tag); match != 0; match &= match - 1) {
+            int slot = first + yacdoc_trailing_zeros(match);
+            if (yacdoc_hashmap_key_equals(map->items[slots[slot]].key, key, hash)) return slot;
+        }
+        unsigned empty = yacdoc_hashmap_group_empty(ctrl + first);
+        if (empty != 0) return first + yacdoc_trailing_zeros(empty);
+        group = (group + step) & group_mask;
+    }
+}
+
+// First empty index slot along the probe sequence of hash
+static int yacdoc_hashmap_probe_empty(YacDocHashMap *map, uint64_t hash) {
+    const uint8_t *ctrl = yacdoc_hashmap_ctrl(map);
+    int group_mask = map->capacity / YACDOC_HASHMAP_GROUP_SIZE - 1;
+    int group = yacdoc_hashmap_probe_start(map, hash);
+    unsigned empty;
+    for (int step = 1; (empty = yacdoc_hashmap_group_empty(ctrl + group * YACDOC_HASHMAP_GROUP_SIZE)) == 0; step++) {
+        group = (group + step) & group_mask;
+    }
+    return group * YACDOC_HASHMAP_GROUP_SIZE + yacdoc_trailing_zeros(empty);
+}
+
+// Points a free index slot at item number index
+static void yacdoc_hashmap_index(YacDocHashMap *map, int slot, uint64_t hash, int index) {
+    yacdoc_hashmap_ctrl(map)[slot] = yacdoc_hashmap_tag(hash);
+    yacdoc_hashmap_slots(map)[slot] = index;
+}
+
+// The items are copied over in order and indexed afresh, so the order stays
+// the insertion order whatever the capacity
+static void yacdoc_hashmap_rehash(YacDocHashMap *map, int capacity) {
+    YacDocHashMapItem *old_items = map->items;
+    void *old_block = yacdoc_hashmap_block(map);
+    map->capacity = capacity;
+    char *block = yacdoc_alloc(map->allocator, yacdoc_hashmap_block_size(capacity));
+    map->items = (YacDocHashMapItem *) (block + yacdoc_hashmap_index_size(capacity));
+    memcpy(map->items, old_items, map->size * sizeof(YacDocHashMapItem));
+    memset(block, YACDOC_HASHMAP_EMPTY, capacity);
     for (int i = 0; i < map->size; i++) {
-        yacdoc_hashmap_add(map, old_items[i]->key, old_items[i]->value);
+        uint64_t hash = yacdoc_hashmap_key(map->items[i].key)->hash;
+        yacdoc_hashmap_index(map, yacdoc_hashmap_probe_empty(map, hash), hash, i);
     }
+    yacdoc_free(map->allocator, old_block);
 }
 
-bool yacdoc_hashmap_add(YacDocHashMap *map, const char *key, void *value) {
-    if (map->size == map->capacity) {
-        yacdoc_hashmap_resize(map);
+// Items are kept packed in insertion order, so iterating a map is a sweep
+// over its size and not its capacity. Small maps have no index: they are
+// searched by comparing all their tags at once, which beats probing for the
+// handful of members most objects and elements have. Past
+// YACDOC_HASHMAP_MAX_FLAT_SIZE they get an index of control byte groups kept
+// at most seven eighths full, since a probe checks a whole group at a time
+static void yacdoc_hashmap_reserve_one(YacDocHashMap *map) {
+    if (map->size < yacdoc_hashmap_item_capacity(map->capacity)) return;
+    if (map->capacity == 0) {
+        map->capacity = YACDOC_HASHMAP_FLAT_INITIAL_CAPACITY;
+        map->items = yacdoc_alloc(map->allocator, yacdoc_hashmap_block_size(map->capacity));
+    } else if (map->capacity < YACDOC_HASHMAP_MAX_FLAT_SIZE) {
+        int capacity = map->capacity * 2;
+        map->items = yacdoc_realloc(map->allocator, map->items, yacdoc_hashmap_block_size(map->capacity), yacdoc_hashmap_block_size(capacity));
+        map->capacity = capacity;
+    } else if (yacdoc_hashmap_is_flat(map)) {
+        yacdoc_hashmap_rehash(map, YACDOC_HASHMAP_INITIAL_CAPACITY);
+    } else {
+        yacdoc_hashmap_rehash(map, map->capacity * 2);
     }
-    int hash = yacdoc_djb2_hash(key);
-    int index = yacdoc_positive_mod(hash, map->capacity);
-    while (map->items[index] != NULL) {
-        if (!strcmp(map->items[index]->key, key)) {
-            return false;
-        }
-        index++;
-        index %= map->capacity;
+}
+
+// Item number of key in a flat map, or its size
+static int yacdoc_hashmap_find_flat(YacDocHashMap *map, const char *key, uint64_t hash) {
+    for (uint64_t match = yacdoc_hashmap_flat_match(map->tags, yacdoc_hashmap_tag(hash)); match != 0; match &= match - 1) {
+        int index = yacdoc_trailing_zeros(match) / 8;
+        if (index >= map->size) break;
+        if (yacdoc_hashmap_key_equals(map->items[index].key, key, hash)) return index;
     }
-    YacDocHashMapItem *item = malloc(sizeof(YacDocHashMapItem));
-    assert(item != NULL);
-    item->key = malloc(strlen(key) + 1);
-    assert(item->key != NULL);
-    strcpy(item->key, key);
-    item->value = value;
-    map->items[index] = item;
+    return map->size;
+}
+
+static bool yacdoc_hashmap_insert(YacDocHashMap *map, const char *key, uint64_t hash, YacDocHashMapKey *interned, void *value) {
+    yacdoc_hashmap_reserve_one(map);
+    if (yacdoc_hashmap_is_flat(map)) {
+        if (yacdoc_hashmap_find_flat(map, key, hash) < map->size) return false;
+        map->tags[map->size] = yacdoc_hashmap_tag(hash);
+    } else {
+        int slot = yacdoc_hashmap_probe(map, key, hash);
+        if (!(yacdoc_hashmap_ctrl(map)[slot] & YACDOC_HASHMAP_EMPTY)) return false;
+        yacdoc_hashmap_index(map, slot, hash, map->size);
+    }
+    if (interned != NULL) {
+        interned->refs++;
+    } else {
+        interned = yacdoc_hashmap_key_new(map->allocator, key, strlen(key), hash);
+    }
+    map->items[map->size].key = interned->data;
+    map->items[map->size].value = value;
     map->size++;
     return true;
 }
 
+bool yacdoc_hashmap_add(YacDocHashMap *map, const char *key, void *value) {
+    return yacdoc_hashmap_insert(map, key, yacdoc_hashmap_hash(key), NULL, value);
+}
+
+// Adds under a key returned by yacdoc_key_table_intern, which the map shares
+// instead of copying. The table must use the same allocator as the map
+bool yacdoc_hashmap_add_interned(YacDocHashMap *map, char *key, void *value) {
+    YacDocHashMapKey *header = yacdoc_hashmap_key(key);
+    return yacdoc_hashmap_insert(map, key, header->hash, header, value);
+}
+
+// Hash of a key as used by the map, so lookups repeated with the same key can
+// compute it once and pass it to yacdoc_hashmap_get_hashed
+uint64_t yacdoc_hashmap_hash(const char *key) {
+    uint64_t hash = 5381;
+    for (; *key != '\0'; key++) hash = yacdoc_hash_step(hash, *key);
+    return yacdoc_hash_finish(hash);
+}
+
 void *yacdoc_hashmap_get(YacDocHashMap *map, const char *key) {
-    int hash = yacdoc_djb2_hash(key);
-    int index = yacdoc_positive_mod(hash, map->capacity);
-    int count = 0;
-    while (map->items[index] != NULL && count < map->capacity) {
-        if (!strcmp(map->items[index]->key, key)) {
-            return map->items[index]->value;
-        }
-        index++;
-        index %= map->capacity;
-        count++;
+    return yacdoc_hashmap_get_hashed(map, key, yacdoc_hashmap_hash(key));
+}
+
+// Interned keys, such as those of another object of the same document, are
+// matched by pointer before the hashes and the strings are compared
+void *yacdoc_hashmap_get_hashed(YacDocHashMap *map, const char *key, uint64_t hash) {
+    if (yacdoc_hashmap_is_flat(map)) {
+        int index = yacdoc_hashmap_find_flat(map, key, hash);
+        return index < map->size ? map->items[index].value : NULL;
     }
-    return NULL;
+    int slot = yacdoc_hashmap_probe(map, key, hash);
+    if (yacdoc_hashmap_ctrl(map)[slot] & YACDOC_HASHMAP_EMPTY) return NULL;
+    return map->items[yacdoc_hashmap_slots(map)[slot]].value;
 }
 
-YacDocHashMapIterator *yacdoc_hashmap_iterator_new(YacDocHashMap *map) {
-    YacDocHashMapIterator *it = malloc(sizeof(YacDocHashMapIterator));
-    assert(it != NULL);
-    it->count = 0;
-    it->last = -1;
-    it->map = map;
-    return it;
+// The keys come from allocator, the table itself from malloc
+YacDocKeyTable *yacdoc_key_table_new_with(const YacDocAllocator *allocator) {
+    YacDocKeyTable *table = malloc(sizeof(YacDocKeyTable));
+    assert(table != NULL);
+    table->capacity = YACDOC_KEY_TABLE_INITIAL_CAPACITY;
+    table->size = 0;
+    table->keys = calloc(table->capacity, sizeof(YacDocHashMapKey *));
+    assert(table->keys != NULL);
+    table->allocator = allocator;
+    return table;
 }
 
-void yacdoc_hashmap_iterator_free(YacDocHashMapIterator *it) {
-    free(it);
+// Keys outlive the table for as long as a map holds them; the table only
+// drops its own reference
+void yacdoc_key_table_free(YacDocKeyTable *table) {
+    if (!yacdoc_allocator_frees_in_bulk(table->allocator)) {
+        for (int i = 0; i < table->capacity; i++) {
+            if (table->keys[i] != NULL) yacdoc_hashmap_key_release(table->allocator, table->keys[i]);
+        }
+    }
+    free(table->keys);
+    free(table);
 }
 
-YacDocHashMapItem *yacdoc_hashmap_iterator_next(YacDocHashMapIterator *it) {
-    YacDocHashMapItem *item;
-    for (int i = it->last + 1; i < it->map->capacity; i++) {
-        if ((item = it->map->items[i]) != NULL) {
-            it->count++;
-            it->last = i;
-            return item;
+static void yacdoc_key_table_resize(YacDocKeyTable *table) {
+    YacDocHashMapKey **old_keys = table->keys;
+    int old_capacity = table->capacity;
+    table->capacity *= 2;
+    table->keys = calloc(table->capacity, sizeof(YacDocHashMapKey *));
+    assert(table->keys != NULL);
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_keys[i] == NULL) continue;
+        int index = (int) (old_keys[i]->hash & (uint64_t) (table->capacity - 1));
+        while (table->keys[index] != NULL) {
+            index = (index + 1) & (table->capacity - 1);
+        }
+        table->keys[index] = old_keys[i];
+    }
+    free(old_keys);
+}
+
+// Returns the NUL-terminated copy of the len bytes at key that the table holds,
+// making it on first sight. key must not contain NUL
+char *yacdoc_key_table_intern(YacDocKeyTable *table, const char *key, size_t len) {
+    uint64_t hash = yacdoc_hash_bytes(key, len);
+    int index = (int) (hash & (uint64_t) (table->capacity - 1));
+    YacDocHashMapKey *header;
+    while ((header = table->keys[index]) != NULL) {
+        if (header->hash == hash && !strncmp(header->data, key, len) && header->data[len] == '\0') {
+            return header->data;
         }
+        index = (index + 1) & (table->capacity - 1);
     }
-    return NULL;
+    header = yacdoc_hashmap_key_new(table->allocator, key, len, hash);
+    table->keys[index] = header;
+    if (++table->size * 2 > table->capacity) yacdoc_key_table_resize(table);
+    return header->data;
+}
+
+// Iterators live wherever the caller puts them, usually on its stack, and
+// need no freeing
+void yacdoc_hashmap_iterator_init(YacDocHashMapIterator *it, YacDocHashMap *map) {
+    it->count = 0;
+    it->map = map;
+}
+
+YacDocHashMapItem *yacdoc_hashmap_iterator_next(YacDocHashMapIterator *it) {
+    if (it->count >= it->map->size) return NULL;
+    return &it->map->items[it->count++];
 }
 
 int yacdoc_hashmap_iterator_count(YacDocHashMapIterator *it) {
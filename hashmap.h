@@ -1,31 +1,70 @@
 #ifndef YACDOC_HASHMAP_H
 #define YACDOC_HASHMAP_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "allocator.h"
+
+// Every key a map holds is stored behind this header, which keeps its hash
+// and how many maps and key tables share it, unless its allocator frees in
+// bulk
+typedef struct {
+    uint64_t hash;
+    int refs;
+    char data[];
+} YacDocHashMapKey;
+
 typedef struct {
     char *key;
     void *value;
 } YacDocHashMapItem;
 
+// Items are kept packed in insertion order, which is the order iterators
+// return them in, and move when the map grows. Up to eight items the map is
+// flat: tags holds a control byte per item with seven bits of its key's hash.
+// Larger maps index their items with a table of capacity such bytes, 0x80
+// marking an empty slot, each with the number of the item it points to,
+// allocated right before items. cache is left to the owner, NULL until it
+// sets it
 typedef struct {
     int capacity;
     int size;
-    YacDocHashMapItem **items;
+    YacDocHashMapItem *items;
+    const YacDocAllocator *allocator;
+    void *cache;
+    uint8_t tags[8];
 } YacDocHashMap;
 
 typedef struct {
     int count;
-    int last;
     YacDocHashMap *map;
 } YacDocHashMapIterator;
 
-typedef void (* YacDocHashMapValueFreeFunc)(void *);
+// Interns the keys of one document so that each distinct key is stored and
+// hashed once however many objects use it
+typedef struct {
+    int capacity;
+    int size;
+    YacDocHashMapKey **keys;
+    const YacDocAllocator *allocator;
+} YacDocKeyTable;
+
+// Called on each value with the map's allocator, for values taken from it
+typedef void (* YacDocHashMapValueFreeFunc)(void *value, const YacDocAllocator *allocator);
 
 YacDocHashMap *yacdoc_hashmap_new();
+YacDocHashMap *yacdoc_hashmap_new_with(const YacDocAllocator *allocator);
 void yacdoc_hashmap_free(YacDocHashMap *map, YacDocHashMapValueFreeFunc free_func);
 bool yacdoc_hashmap_add(YacDocHashMap *map, const char* key, void *value);
 void *yacdoc_hashmap_get(YacDocHashMap *map, const char* key);
-YacDocHashMapIterator *yacdoc_hashmap_iterator_new(YacDocHashMap *map);
-void yacdoc_hashmap_iterator_free(YacDocHashMapIterator *it);
+uint64_t yacdoc_hashmap_hash(const char *key);
+void *yacdoc_hashmap_get_hashed(YacDocHashMap *map, const char *key, uint64_t hash);
+bool yacdoc_hashmap_add_interned(YacDocHashMap *map, char *key, void *value);
+YacDocKeyTable *yacdoc_key_table_new_with(const YacDocAllocator *allocator);
+void yacdoc_key_table_free(YacDocKeyTable *table);
+char *yacdoc_key_table_intern(YacDocKeyTable *table, const char *key, size_t len);
+void yacdoc_hashmap_iterator_init(YacDocHashMapIterator *it, YacDocHashMap *map);
 YacDocHashMapItem *yacdoc_hashmap_iterator_next(YacDocHashMapIterator *it);
 int yacdoc_hashmap_iterator_count(YacDocHashMapIterator *it);
 
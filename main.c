@@ -2,6 +2,7 @@
 #include <stdlib.h>
 
 #include "yacjson-core.h"
+#include "yacjson-lazy.h"
 #include "yacxml-core.h"
 
 int main(void) {
@@ -17,5 +18,10 @@ int main(void) {
     puts(yacxml_element_get_text(child));
     yacxml_serialize(elem, "./tests/test_out.xml");
     yacxml_element_free(elem);
+    YacJSONLazyDocument *doc = yacjson_lazy_document_parse_mmap("./tests/test.json");
+    YacJSONValue *firstname = yacjson_lazy_value_materialize(yacjson_lazy_object_get(yacjson_lazy_document_root(doc), "firstname"));
+    puts(yacjson_value_to_string(firstname));
+    yacjson_value_free(firstname);
+    yacjson_lazy_document_free(doc);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,42 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapfile.h"
+
+static void yacdoc_mapped_file_map(YacDocMappedFile *file, const char *filepath, int prot) {
+    int fd = open(filepath, O_RDONLY);
+    assert(fd != -1);
+    struct stat st;
+    int result = fstat(fd, &st);
+    assert(result != -1);
+    (void) result;
+    file->len = st.st_size;
+    file->data = NULL;
+    if (file->len > 0) {
+        file->data = mmap(NULL, file->len, prot, MAP_PRIVATE, fd, 0);
+        assert(file->data != MAP_FAILED);
+        posix_madvise(file->data, file->len, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd);
+}
+
+void yacdoc_mapped_file_open(YacDocMappedFile *file, const char *filepath) {
+    yacdoc_mapped_file_map(file, filepath, PROT_READ);
+}
+
+// Writes go to private copy-on-write pages and never reach the file
+void yacdoc_mapped_file_open_writable(YacDocMappedFile *file, const char *filepath) {
+    yacdoc_mapped_file_map(file, filepath, PROT_READ | PROT_WRITE);
+}
+
+void yacdoc_mapped_file_close(YacDocMappedFile *file) {
+    if (file->data != NULL) munmap(file->data, file->len);
+    file->data = NULL;
+    file->len = 0;
+}
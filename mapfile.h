@@ -0,0 +1,15 @@
+#ifndef YACDOC_MAPFILE_H
+#define YACDOC_MAPFILE_H
+
+#include <stddef.h>
+
+typedef struct {
+    char *data;
+    size_t len;
+} YacDocMappedFile;
+
+void yacdoc_mapped_file_open(YacDocMappedFile *file, const char *filepath);
+void yacdoc_mapped_file_open_writable(YacDocMappedFile *file, const char *filepath);
+void yacdoc_mapped_file_close(YacDocMappedFile *file);
+
+#endif
@@ -0,0 +1,163 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+#define YACDOC_POOL_CHUNK_SIZE (64 * 1024)
+#define YACDOC_POOL_CHUNK_MASK ((uintptr_t) YACDOC_POOL_CHUNK_SIZE - 1)
+#define YACDOC_POOL_CHUNKS_INITIAL_CAPACITY (64)
+
+static size_t yacdoc_pool_node_size(int size_class) {
+    return (size_t) (size_class + 1) * 16;
+}
+
+static int yacdoc_pool_chunk_index(YacDocPool *pool, uintptr_t base) {
+    uint64_t hash = (uint64_t) (base >> 16) * 0x9E3779B97F4A7C15ULL;
+    return (int) ((hash >> 32) & (uint64_t) (pool->chunk_capacity - 1));
+}
+
+static void yacdoc_pool_chunks_insert(YacDocPool *pool, uintptr_t entry) {
+    int index = yacdoc_pool_chunk_index(pool, entry & ~YACDOC_POOL_CHUNK_MASK);
+    while (pool->chunks[index] != 0) index = (index + 1) & (pool->chunk_capacity - 1);
+    pool->chunks[index] = entry;
+}
+
+static void yacdoc_pool_chunks_grow(YacDocPool *pool) {
+    uintptr_t *old_chunks = pool->chunks;
+    int old_capacity = pool->chunk_capacity;
+    pool->chunk_capacity *= 2;
+    pool->chunks = calloc(pool->chunk_capacity, sizeof(uintptr_t));
+    assert(pool->chunks != NULL);
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_chunks[i] != 0) yacdoc_pool_chunks_insert(pool, old_chunks[i]);
+    }
+    free(old_chunks);
+}
+
+// Size class of the node at ptr, or -1 when ptr is a large block
+static int yacdoc_pool_size_class(YacDocPool *pool, void *ptr) {
+    uintptr_t base = (uintptr_t) ptr & ~YACDOC_POOL_CHUNK_MASK;
+    int index = yacdoc_pool_chunk_index(pool, base);
+    uintptr_t entry;
+    while ((entry = pool->chunks[index]) != 0) {
+        if ((entry & ~YACDOC_POOL_CHUNK_MASK) == base) return (int) (entry & YACDOC_POOL_CHUNK_MASK);
+        index = (index + 1) & (pool->chunk_capacity - 1);
+    }
+    return -1;
+}
+
+static void yacdoc_pool_chunk_new(YacDocPool *pool, int size_class) {
+    void *chunk;
+    if (posix_memalign(&chunk, YACDOC_POOL_CHUNK_SIZE, YACDOC_POOL_CHUNK_SIZE) != 0) chunk = NULL;
+    assert(chunk != NULL);
+    if (++pool->chunk_count * 2 > pool->chunk_capacity) yacdoc_pool_chunks_grow(pool);
+    yacdoc_pool_chunks_insert(pool, (uintptr_t) chunk | (uintptr_t) size_class);
+    pool->next[size_class] = chunk;
+    pool->end[size_class] = (char *) chunk + YACDOC_POOL_CHUNK_SIZE;
+}
+
+static void *yacdoc_pool_large_alloc(YacDocPool *pool, size_t size) {
+    YacDocPoolLarge *large = malloc(sizeof(YacDocPoolLarge) + size);
+    if (large == NULL) return NULL;
+    large->prev = &pool->large;
+    large->next = pool->large.next;
+    pool->large.next->prev = large;
+    pool->large.next = large;
+    return large + 1;
+}
+
+static void *yacdoc_pool_alloc(void *ctx, size_t size) {
+    YacDocPool *pool = ctx;
+    if (size > YACDOC_POOL_MAX_NODE_SIZE) return yacdoc_pool_large_alloc(pool, size);
+    int size_class = size == 0 ? 0 : (int) ((size - 1) / 16);
+    void *node = pool->free_nodes[size_class];
+    if (node != NULL) {
+        pool->free_nodes[size_class] = *(void **) node;
+        return node;
+    }
+    size_t node_size = yacdoc_pool_node_size(size_class);
+    if (pool->end[size_class] - pool->next[size_class] < (ptrdiff_t) node_size) yacdoc_pool_chunk_new(pool, size_class);
+    node = pool->next[size_class];
+    pool->next[size_class] += node_size;
+    return node;
+}
+
+static void yacdoc_pool_release(void *ctx, void *ptr) {
+    YacDocPool *pool = ctx;
+    if (ptr == NULL) return;
+    int size_class = yacdoc_pool_size_class(pool, ptr);
+    if (size_class >= 0) {
+        *(void **) ptr = pool->free_nodes[size_class];
+        pool->free_nodes[size_class] = ptr;
+        return;
+    }
+    YacDocPoolLarge *large = (YacDocPoolLarge *) ptr - 1;
+    large->prev->next = large->next;
+    large->next->prev = large->prev;
+    free(large);
+}
+
+// A node stays where it is as long as the new size fits its class, and a
+// large block stays large through realloc; anything else moves
+static void *yacdoc_pool_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    YacDocPool *pool = ctx;
+    if (ptr == NULL) return yacdoc_pool_alloc(pool, new_size);
+    int size_class = yacdoc_pool_size_class(pool, ptr);
+    if (size_class >= 0 && new_size <= yacdoc_pool_node_size(size_class)) return ptr;
+    if (size_class < 0 && new_size > YACDOC_POOL_MAX_NODE_SIZE) {
+        YacDocPoolLarge *large = (YacDocPoolLarge *) ptr - 1;
+        YacDocPoolLarge *prev = large->prev, *next = large->next;
+        large = realloc(large, sizeof(YacDocPoolLarge) + new_size);
+        if (large == NULL) return NULL;
+        prev->next = large;
+        next->prev = large;
+        return large + 1;
+    }
+    void *new_ptr = yacdoc_pool_alloc(pool, new_size);
+    if (new_ptr == NULL) return NULL;
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    yacdoc_pool_release(pool, ptr);
+    return new_ptr;
+}
+
+YacDocPool *yacdoc_pool_new() {
+    YacDocPool *pool = malloc(sizeof(YacDocPool));
+    assert(pool != NULL);
+    for (int i = 0; i < YACDOC_POOL_CLASS_COUNT; i++) {
+        pool->free_nodes[i] = NULL;
+        pool->next[i] = NULL;
+        pool->end[i] = NULL;
+    }
+    pool->chunk_capacity = YACDOC_POOL_CHUNKS_INITIAL_CAPACITY;
+    pool->chunk_count = 0;
+    pool->chunks = calloc(pool->chunk_capacity, sizeof(uintptr_t));
+    assert(pool->chunks != NULL);
+    pool->large.prev = &pool->large;
+    pool->large.next = &pool->large;
+    pool->allocator.alloc = yacdoc_pool_alloc;
+    pool->allocator.realloc = yacdoc_pool_realloc;
+    pool->allocator.free = yacdoc_pool_release;
+    pool->allocator.ctx = pool;
+    return pool;
+}
+
+void yacdoc_pool_free(YacDocPool *pool) {
+    for (int i = 0; i < pool->chunk_capacity; i++) {
+        if (pool->chunks[i] != 0) free((void *) (pool->chunks[i] & ~YACDOC_POOL_CHUNK_MASK));
+    }
+    YacDocPoolLarge *large = pool->large.next;
+    while (large != &pool->large) {
+        YacDocPoolLarge *next = large->next;
+        free(large);
+        large = next;
+    }
+    free(pool->chunks);
+    free(pool);
+}
+
+const YacDocAllocator *yacdoc_pool_allocator(YacDocPool *pool) {
+    return &pool->allocator;
+}
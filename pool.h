@@ -0,0 +1,43 @@
+#ifndef YACDOC_POOL_H
+#define YACDOC_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "allocator.h"
+
+typedef struct YacDocPoolLarge {
+    struct YacDocPoolLarge *prev;
+    struct YacDocPoolLarge *next;
+} YacDocPoolLarge;
+
+// Fixed-size node allocator for the many small blocks of a tree: values,
+// maps, lists, elements, keys and short strings. Blocks of up to
+// YACDOC_POOL_MAX_NODE_SIZE bytes are rounded up to a multiple of 16 and cut
+// from chunks that each hold nodes of one size; freed nodes go on a list per
+// size and are handed out again first. Larger blocks come from malloc and are
+// linked in large. chunks is an open-addressing set of the chunk addresses,
+// each tagged in its low bits with the size class of its nodes, which is how
+// a freed pointer is told apart and sized. A pool is not thread-safe, so it
+// suits one thread or one request at a time. yacdoc_pool_free releases
+// everything that is left, so a tree built from a pool may be dropped with
+// the pool instead of freed node by node
+#define YACDOC_POOL_CLASS_COUNT (8)
+#define YACDOC_POOL_MAX_NODE_SIZE (YACDOC_POOL_CLASS_COUNT * 16)
+
+typedef struct {
+    void *free_nodes[YACDOC_POOL_CLASS_COUNT];
+    char *next[YACDOC_POOL_CLASS_COUNT];
+    char *end[YACDOC_POOL_CLASS_COUNT];
+    uintptr_t *chunks;
+    int chunk_capacity;
+    int chunk_count;
+    YacDocPoolLarge large;
+    YacDocAllocator allocator;
+} YacDocPool;
+
+YacDocPool *yacdoc_pool_new();
+void yacdoc_pool_free(YacDocPool *pool);
+const YacDocAllocator *yacdoc_pool_allocator(YacDocPool *pool);
+
+#endif
@@ -0,0 +1,477 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../hashmap.h"
+#include "../yacjson-lazy.h"
+#include "../yacjson-push.h"
+#include "../yacjson-query.h"
+#include "../yacjson-sax.h"
+#include "../yacjson-schema.h"
+#include "../yacxml-core.h"
+#include "../yacjson-number.h"
+#include "../yacjson-validate.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+// Same sequence on every run, so every failure can be replayed
+static uint64_t test_random_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t test_random() {
+    test_random_state ^= test_random_state << 13;
+    test_random_state ^= test_random_state >> 7;
+    test_random_state ^= test_random_state << 17;
+    return test_random_state;
+}
+
+static YacJSONNumberType test_parse(const char *text, long *integer, double *decimal) {
+    return yacjson_number_parse(text, strlen(text), integer, decimal);
+}
+
+static bool test_parses_as(const char *text, double expected) {
+    long integer;
+    double decimal;
+    if (test_parse(text, &integer, &decimal) != YACJSON_NUMBER_DECIMAL) return false;
+    return memcmp(&decimal, &expected, sizeof(double)) == 0;
+}
+
+static void test_number_parse() {
+    const char *invalid[] = {"01", "-01", "1.", ".5", "+1", "1e", "1e+", "-", "0x10", "1.e5", "--1", "1a"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        long integer;
+        double decimal;
+        CHECK(test_parse(invalid[i], &integer, &decimal) == YACJSON_NUMBER_INVALID);
+    }
+    long integer;
+    double decimal;
+    CHECK(test_parse("0", &integer, &decimal) == YACJSON_NUMBER_INTEGER && integer == 0);
+    CHECK(test_parse("-0", &integer, &decimal) == YACJSON_NUMBER_INTEGER && integer == 0);
+    CHECK(test_parse("9223372036854775807", &integer, &decimal) == YACJSON_NUMBER_INTEGER && integer == 9223372036854775807L);
+    CHECK(test_parse("-9223372036854775808", &integer, &decimal) == YACJSON_NUMBER_INTEGER && integer == -9223372036854775807L - 1);
+    // Integers past a long become decimals
+    CHECK(test_parses_as("9223372036854775808", 9223372036854775808.0));
+    CHECK(test_parses_as("-9223372036854775809", -9223372036854775808.0));
+    CHECK(test_parse("1e309", &integer, &decimal) == YACJSON_NUMBER_OUT_OF_RANGE);
+    CHECK(test_parses_as("5e-324", 4.9406564584124654e-324));
+    CHECK(test_parses_as("2e-324", 0.0));
+    CHECK(test_parses_as("3e-324", 4.9406564584124654e-324));
+    CHECK(test_parses_as("2.2250738585072011e-308", 2.225073858507201e-308));
+    CHECK(test_parses_as("2.2250738585072014e-308", 2.2250738585072014e-308));
+    CHECK(test_parses_as("1.7976931348623157e308", 1.7976931348623157e308));
+    // Halfway cases round to even
+    CHECK(test_parses_as("9007199254740993.0", 9007199254740992.0));
+    CHECK(test_parses_as("9007199254740995.0", 9007199254740996.0));
+    CHECK(test_parses_as("9007199254740993.00000000000000000000001", 9007199254740994.0));
+    CHECK(test_parses_as("0.1", 0.1));
+    CHECK(test_parses_as("-0.0", -0.0));
+    CHECK(test_parses_as("1E2", 100.0));
+    // Random digit strings of every length, against strtod in the C locale
+    char text[64];
+    for (int i = 0; i < 200000; i++) {
+        uint64_t bits = test_random();
+        int digits = 1 + (int) (bits % 25);
+        size_t len = 0;
+        if (bits >> 63) text[len++] = '-';
+        for (int j = 0; j < digits; j++) {
+            text[len++] = (char) ('0' + test_random() % 10);
+            if (j == 0 && text[len - 1] == '0') text[len - 1] = '1';
+            if (j == 0 && digits > 1 && (bits >> 40) % 2) text[len++] = '.';
+        }
+        len += sprintf(text + len, "e%d", (int) ((bits >> 8) % 700) - 350);
+        text[len] = '\0';
+        double expected = strtod(text, NULL);
+        YacJSONNumberType type = test_parse(text, &integer, &decimal);
+        if (isinf(expected)) {
+            CHECK(type == YACJSON_NUMBER_OUT_OF_RANGE);
+        } else {
+            CHECK(type == YACJSON_NUMBER_DECIMAL && memcmp(&decimal, &expected, sizeof(double)) == 0);
+        }
+    }
+}
+
+static bool test_formats_as(double value, const char *expected) {
+    char buf[YACJSON_NUMBER_MAX_FORMAT_LEN + 1];
+    buf[yacjson_number_format_decimal(value, buf)] = '\0';
+    return strcmp(buf, expected) == 0;
+}
+
+static void test_number_format() {
+    // Expected strings are Python's repr of the same doubles
+    CHECK(test_formats_as(0.1, "0.1"));
+    CHECK(test_formats_as(1e16, "1e+16"));
+    CHECK(test_formats_as(1e15, "1000000000000000.0"));
+    CHECK(test_formats_as(0.0001, "0.0001"));
+    CHECK(test_formats_as(0.00001, "1e-05"));
+    CHECK(test_formats_as(5e-324, "5e-324"));
+    CHECK(test_formats_as(1.7976931348623157e308, "1.7976931348623157e+308"));
+    CHECK(test_formats_as(2.0, "2.0"));
+    CHECK(test_formats_as(-0.0, "-0.0"));
+    CHECK(test_formats_as(123456789.125, "123456789.125"));
+    CHECK(test_formats_as(2.2250738585072014e-308, "2.2250738585072014e-308"));
+    CHECK(test_formats_as(2.225073858507201e-308, "2.225073858507201e-308"));
+    CHECK(test_formats_as(1.0 / 3.0, "0.3333333333333333"));
+    CHECK(test_formats_as(1e-7, "1e-07"));
+    CHECK(test_formats_as(123e20, "1.23e+22"));
+    CHECK(test_formats_as(INFINITY, "null"));
+    CHECK(test_formats_as(NAN, "null"));
+    char buf[YACJSON_NUMBER_MAX_FORMAT_LEN + 1];
+    buf[yacjson_number_format_integer(-9223372036854775807L - 1, buf)] = '\0';
+    CHECK(strcmp(buf, "-9223372036854775808") == 0);
+    buf[yacjson_number_format_integer(0, buf)] = '\0';
+    CHECK(strcmp(buf, "0") == 0);
+    // Random bit patterns, including subnormals, read back unchanged
+    for (int i = 0; i < 200000; i++) {
+        uint64_t bits = test_random();
+        if (i % 4 == 0) bits &= 0x800FFFFFFFFFFFFFULL;
+        double value;
+        memcpy(&value, &bits, sizeof(double));
+        if (!isfinite(value)) continue;
+        buf[yacjson_number_format_decimal(value, buf)] = '\0';
+        double back = strtod(buf, NULL);
+        CHECK(memcmp(&back, &value, sizeof(double)) == 0);
+    }
+}
+
+static void test_validate_case(const char *data, size_t len, YacJSONValidateError expected, size_t expected_offset) {
+    size_t offset;
+    CHECK(yacjson_validate(data, len, &offset) == expected);
+    CHECK(offset == expected_offset);
+}
+
+// bad is put inside a string long enough for the vector paths, at every
+// position of the string's first 64 bytes
+static void test_validate_utf8(const char *bad, size_t bad_len, bool is_valid) {
+    char data[256];
+    for (size_t at = 0; at < 64; at++) {
+        size_t len = 0;
+        data[len++] = '[';
+        data[len++] = '"';
+        memset(data + len, 'a', at);
+        len += at;
+        memcpy(data + len, bad, bad_len);
+        len += bad_len;
+        memset(data + len, 'b', 100);
+        len += 100;
+        data[len++] = '"';
+        data[len++] = ']';
+        if (is_valid) {
+            test_validate_case(data, len, YACJSON_VALIDATE_OK, len);
+        } else {
+            test_validate_case(data, len, YACJSON_VALIDATE_INVALID_UTF8, 2 + at);
+        }
+    }
+}
+
+static void test_validate() {
+    test_validate_case("{\"a\":[1,2.5,true,false,null,\"x\"]}", 33, YACJSON_VALIDATE_OK, 33);
+    test_validate_case("[01]", 4, YACJSON_VALIDATE_INVALID_NUMBER, 1);
+    test_validate_case("[1.]", 4, YACJSON_VALIDATE_INVALID_NUMBER, 1);
+    test_validate_case("[.5]", 4, YACJSON_VALIDATE_UNEXPECTED_CHARACTER, 1);
+    test_validate_case("[1] x", 5, YACJSON_VALIDATE_TRAILING_CONTENT, 4);
+    test_validate_case("[nul]", 5, YACJSON_VALIDATE_INVALID_LITERAL, 1);
+    test_validate_case("[\"\\x\"]", 6, YACJSON_VALIDATE_INVALID_ESCAPE, 2);
+    test_validate_case("[\"\n\"]", 5, YACJSON_VALIDATE_CONTROL_CHARACTER, 2);
+    test_validate_case("[1,", 3, YACJSON_VALIDATE_UNEXPECTED_END, 3);
+    test_validate_case("1", 1, YACJSON_VALIDATE_UNEXPECTED_CHARACTER, 0);
+    char deep[YACJSON_VALIDATE_MAX_DEPTH + 1];
+    memset(deep, '[', sizeof(deep));
+    test_validate_case(deep, sizeof(deep), YACJSON_VALIDATE_TOO_DEEP, YACJSON_VALIDATE_MAX_DEPTH);
+    test_validate_utf8("\xC3\xA9", 2, true);
+    test_validate_utf8("\xE2\x82\xAC", 3, true);
+    test_validate_utf8("\xF0\x9F\x98\x80", 4, true);
+    test_validate_utf8("\xF4\x8F\xBF\xBF", 4, true);
+    // Overlongs
+    test_validate_utf8("\xC0\xAF", 2, false);
+    test_validate_utf8("\xC1\xBF", 2, false);
+    test_validate_utf8("\xE0\x80\xAF", 3, false);
+    test_validate_utf8("\xF0\x80\x80\xAF", 4, false);
+    // Surrogates and code points past U+10FFFF
+    test_validate_utf8("\xED\xA0\x80", 3, false);
+    test_validate_utf8("\xED\xBF\xBF", 3, false);
+    test_validate_utf8("\xF4\x90\x80\x80", 4, false);
+    test_validate_utf8("\xF5\x80\x80\x80", 4, false);
+    // Truncated sequences and stray continuation bytes
+    test_validate_utf8("\xC3", 1, false);
+    test_validate_utf8("\xE2\x82", 2, false);
+    test_validate_utf8("\xF0\x9F\x98", 3, false);
+    test_validate_utf8("\x80", 1, false);
+    test_validate_utf8("\xFF", 1, false);
+    // The truncated sequence comes before the missing end, so it is reported
+    test_validate_case("[\"\xE2\x82", 5, YACJSON_VALIDATE_INVALID_UTF8, 2);
+}
+
+static void test_hashmap_free_value(void *value, const YacDocAllocator *allocator) {
+    (void) value;
+    (void) allocator;
+}
+
+static void test_hashmap() {
+    YacDocHashMap *map = yacdoc_hashmap_new();
+    char key[32];
+    // Past the flat size of 8, then past 7/8 of every capacity on the way
+    for (long i = 0; i < 5000; i++) {
+        sprintf(key, "key%ld", i);
+        CHECK(yacdoc_hashmap_add(map, key, (void *) (i + 1)));
+        CHECK(!yacdoc_hashmap_add(map, key, NULL));
+        CHECK(map->size == i + 1);
+        if (i < 64 || (i & (i + 1)) == 0 || i % 997 == 0) {
+            for (long j = 0; j <= i; j++) {
+                sprintf(key, "key%ld", j);
+                CHECK(yacdoc_hashmap_get(map, key) == (void *) (j + 1));
+            }
+            sprintf(key, "missing%ld", i);
+            CHECK(yacdoc_hashmap_get(map, key) == NULL);
+        }
+    }
+    // Iteration follows insertion order whatever the capacity
+    YacDocHashMapIterator it;
+    yacdoc_hashmap_iterator_init(&it, map);
+    long count = 0;
+    YacDocHashMapItem *item;
+    while ((item = yacdoc_hashmap_iterator_next(&it)) != NULL) {
+        sprintf(key, "key%ld", count);
+        CHECK(strcmp(item->key, key) == 0 && item->value == (void *) (count + 1));
+        count++;
+    }
+    CHECK(count == 5000);
+    CHECK(yacdoc_hashmap_get(map, "") == NULL);
+    CHECK(yacdoc_hashmap_add(map, "", NULL));
+    CHECK(yacdoc_hashmap_get_hashed(map, "", yacdoc_hashmap_hash("")) == NULL);
+    yacdoc_hashmap_free(map, test_hashmap_free_value);
+}
+
+static void test_lazy() {
+    const char *data = "{\"a\": 01, \"b\": 2, \"c\": {\"d\" 1}, \"e\": \"x\\u0000y\", \"f\": [1.5, true], \"g\": null}";
+    YacJSONLazyDocument *doc = yacjson_lazy_document_parse_buffer(data, strlen(data));
+    YacJSONLazyValue *root = yacjson_lazy_document_root(doc);
+    CHECK(root != NULL);
+    long integer = -1;
+    CHECK(!yacjson_lazy_object_get_integer(root, "a", &integer) && integer == -1);
+    CHECK(yacjson_lazy_object_get_integer(root, "b", &integer) && integer == 2);
+    CHECK(yacjson_lazy_object_get(root, "c") == NULL);
+    CHECK(yacjson_lazy_object_get_object(root, "c") == NULL);
+    CHECK(!yacjson_lazy_object_get_integer(root, "e", &integer));
+    CHECK(!yacjson_lazy_object_get_integer(root, "missing", &integer));
+    CHECK(yacjson_lazy_object_entry(root, 0) == NULL);
+    CHECK(yacjson_lazy_object_entry(root, 1) != NULL);
+    YacJSONValue *value = yacjson_lazy_value_materialize(yacjson_lazy_object_get(root, "e"));
+    CHECK(value != NULL && yacjson_value_string_length(value) == 3 && !memcmp(yacjson_value_to_string(value), "x\0y", 3));
+    yacjson_value_free(value);
+    YacJSONLazyValue *array = yacjson_lazy_object_get_array(root, "f");
+    double decimal;
+    bool boolean;
+    CHECK(yacjson_lazy_array_get_decimal(array, 0, &decimal) && decimal == 1.5);
+    CHECK(yacjson_lazy_array_get_boolean(array, 1, &boolean) && boolean);
+    CHECK(!yacjson_lazy_array_get_boolean(array, 2, &boolean));
+    char *string;
+    CHECK(yacjson_lazy_object_get_string(root, "g", &string) && !strcmp(string, "null"));
+    yacjson_lazy_document_free(doc);
+}
+
+typedef struct {
+    int nulls;
+    int strings;
+} TestSaxCounts;
+
+static YacJSONSaxAction test_sax_null(void *ctx) {
+    ((TestSaxCounts *) ctx)->nulls++;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction test_sax_string(void *ctx, const char *value, size_t len) {
+    (void) value;
+    (void) len;
+    ((TestSaxCounts *) ctx)->strings++;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static bool test_query_null(void *ctx, YacJSONValue *value) {
+    *(bool *) ctx = value->type == YACJSON_STRING && !strcmp(yacjson_value_to_string(value), "null");
+    yacjson_value_free(value);
+    return true;
+}
+
+static void test_sax_null_event() {
+    const YacJSONSaxHandler handler = {.null = test_sax_null, .string = test_sax_string};
+    const char *data = "[null, \"null\", nul, {\"a\": null}]";
+    TestSaxCounts counts = {0, 0};
+    CHECK(yacjson_sax_parse_buffer(data, strlen(data), &handler, &counts) == YACJSON_SAX_DONE);
+    CHECK(counts.nulls == 2 && counts.strings == 2);
+    counts.nulls = counts.strings = 0;
+    YacJSONPushParser *parser = yacjson_push_parser_new(&handler, &counts);
+    for (size_t i = 0; i < strlen(data); i++) CHECK(yacjson_push_parser_feed(parser, data + i, 1));
+    CHECK(yacjson_push_parser_finish(parser) == YACJSON_SAX_DONE);
+    yacjson_push_parser_free(parser);
+    CHECK(counts.nulls == 2 && counts.strings == 2);
+    // Trees keep null as the string "null"
+    YacJSONValue *root = yacjson_parse_buffer(data, strlen(data));
+    YacJSONArray *array = yacjson_value_to_array(root);
+    CHECK(!strcmp(yacjson_array_get_string(array, 0), "null"));
+    CHECK(!strcmp(yacjson_object_get_string(yacjson_array_get_object(array, 3), "a"), "null"));
+    yacjson_value_free(root);
+    YacJSONQuery *query = yacjson_query_compile("/3/a");
+    bool is_null = false;
+    CHECK(yacjson_query_stream_buffer(query, data, strlen(data), test_query_null, &is_null) && is_null);
+    yacjson_query_free(query);
+}
+
+typedef struct {
+    long id;
+    char *name;
+} TestRecord;
+
+static int test_record_match(const char *key, size_t len) {
+    if (len == 2 && !memcmp(key, "id", 2)) return 0;
+    if (len == 4 && !memcmp(key, "name", 4)) return 1;
+    return -1;
+}
+
+static const YacJSONSchemaField test_record_fields[] = {
+    {"id", 2, YACJSON_SCHEMA_INTEGER, false, offsetof(TestRecord, id), 0, NULL},
+    {"name", 4, YACJSON_SCHEMA_STRING, false, offsetof(TestRecord, name), 0, NULL},
+};
+
+static const YacJSONSchemaType test_record_type = {"TestRecord", sizeof(TestRecord), test_record_fields, 2, test_record_match};
+
+static bool test_schema_decodes(const char *data, TestRecord *record) {
+    memset(record, 0, sizeof(TestRecord));
+    return yacjson_schema_decode(&test_record_type, data, strlen(data), record);
+}
+
+static void test_schema_null() {
+    TestRecord record;
+    CHECK(test_schema_decodes("{\"id\": null, \"name\": null}", &record) && record.id == 0 && record.name == NULL);
+    CHECK(!test_schema_decodes("{\"id\": \"null\"}", &record));
+    yacjson_schema_free(&test_record_type, &record);
+    CHECK(test_schema_decodes("{\"id\": 7, \"name\": \"null\"}", &record) && record.id == 7 && !strcmp(record.name, "null"));
+    yacjson_schema_free(&test_record_type, &record);
+}
+
+static bool test_query_first(void *ctx, YacJSONValue *value) {
+    *(long *) ctx = yacjson_value_to_integer(value);
+    yacjson_value_free(value);
+    return true;
+}
+
+static void test_escaped_keys() {
+    const char *data = "{\"k\\\"e\": 1, \"\\u0069d\": 2, \"name\": \"x\"}";
+    YacJSONValue *root = yacjson_parse_buffer(data, strlen(data));
+    YacJSONObject *object = yacjson_value_to_object(root);
+    CHECK(yacjson_object_get_integer(object, "k\"e") == 1);
+    CHECK(yacjson_object_get_integer(object, "id") == 2);
+    yacjson_value_free(root);
+    YacJSONLazyDocument *doc = yacjson_lazy_document_parse_buffer(data, strlen(data));
+    long integer = 0;
+    CHECK(yacjson_lazy_object_get_integer(yacjson_lazy_document_root(doc), "k\"e", &integer) && integer == 1);
+    yacjson_lazy_document_free(doc);
+    YacJSONQuery *query = yacjson_query_compile("/id");
+    integer = 0;
+    CHECK(yacjson_query_stream_buffer(query, data, strlen(data), test_query_first, &integer) && integer == 2);
+    yacjson_query_free(query);
+    TestRecord record;
+    CHECK(test_schema_decodes("{\"\\u0069d\": 3, \"na\\u006de\": \"y\"}", &record) && record.id == 3 && !strcmp(record.name, "y"));
+    yacjson_schema_free(&test_record_type, &record);
+    // Written back escaped, so the output is JSON and reads back the same key
+    const char *control = "{\"a\\\"b\\\\c\\u0001\": 1}";
+    root = yacjson_parse_buffer(control, strlen(control));
+    size_t len;
+    char *buffer = yacjson_serialize_to_buffer(root, NULL, &len);
+    yacjson_value_free(root);
+    CHECK(yacjson_validate(buffer, len, NULL) == YACJSON_VALIDATE_OK);
+    root = yacjson_parse_buffer(buffer, len);
+    CHECK(yacjson_object_get_integer(yacjson_value_to_object(root), "a\"b\\c\x01") == 1);
+    yacjson_value_free(root);
+    free(buffer);
+}
+
+// Counts live blocks, to check that a tree gives back all it took
+static void *test_counting_alloc(void *ctx, size_t size) {
+    (*(int *) ctx)++;
+    return malloc(size);
+}
+
+static void *test_counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void) old_size;
+    if (ptr == NULL) (*(int *) ctx)++;
+    return realloc(ptr, new_size);
+}
+
+static void test_counting_free(void *ctx, void *ptr) {
+    if (ptr != NULL) (*(int *) ctx)--;
+    free(ptr);
+}
+
+static void test_packed_allocator() {
+    int blocks = 0;
+    const YacDocAllocator allocator = {test_counting_alloc, test_counting_realloc, test_counting_free, &blocks};
+    const long longs[] = {1, 2, 3};
+    YacJSONArray *array = yacjson_array_from_longs_with(longs, 3, &allocator);
+    CHECK(blocks == 2 && yacjson_array_get_integer(array, 2) == 3);
+    YacJSONValue *value = yacjson_value_from_array(array);
+    yacjson_value_free(value);
+    CHECK(blocks == 0);
+    const double doubles[] = {0.5, 1.5};
+    value = yacjson_value_from_array(yacjson_array_from_doubles_with(doubles, 2, &allocator));
+    // Boxing gives the packed buffer back to the allocator it came from
+    CHECK(yacjson_value_to_decimal(yacjson_array_get(yacjson_value_to_array(value), 1)) == 1.5);
+    yacjson_value_free(value);
+    CHECK(blocks == 0);
+}
+
+static void test_resolve_strings() {
+    const char *data = "{\"a\": \"x\\n\", \"b\": [\"y\\u0041\", 1], \"c\": [1, 2]}";
+    YacJSONValue *root = yacjson_parse_buffer(data, strlen(data));
+    YacJSONObject *object = yacjson_value_to_object(root);
+    yacjson_value_resolve_strings(root);
+    YacJSONValue *a = yacjson_object_get(object, "a");
+    YacJSONValue *b = yacjson_array_get(yacjson_object_get_array(object, "b"), 0);
+    CHECK(!a->data.string.is_raw && !strcmp(a->data.string.ptr, "x\n"));
+    CHECK(!b->data.string.is_raw && !strcmp(b->data.string.ptr, "yA"));
+    CHECK(yacjson_array_packing(yacjson_object_get_array(object, "c")) == YACJSON_ARRAY_INTEGERS);
+    yacjson_value_free(root);
+}
+
+// Paths are relative to the repository root, where make test runs from
+static void test_xml() {
+    CHECK(yacxml_parse("./tests/missing.xml") == NULL);
+    YacXMLParser *parser = yacxml_parser_new();
+    for (int i = 0; i < 2; i++) {
+        YacXMLElement *elem = yacxml_parser_parse(parser, "./tests/test.xml");
+        YacXMLElement *child = yacxml_element_get_child(yacxml_element_get_child(elem, "consist"), "off");
+        CHECK(!strcmp(yacxml_element_get_attribute(child, "asleep"), "draw"));
+        CHECK(!strcmp(yacxml_element_get_text(child), "industry"));
+        yacxml_element_free(elem);
+    }
+    yacxml_parser_free(parser);
+}
+
+int main(void) {
+    test_number_parse();
+    test_number_format();
+    test_validate();
+    test_hashmap();
+    test_lazy();
+    test_sax_null_event();
+    test_schema_null();
+    test_escaped_keys();
+    test_resolve_strings();
+    test_packed_allocator();
+    test_xml();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    puts("All tests passed");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "threadpool.h"
+
+// Runs tasks until none are left; called and returns with the mutex held
+static void yacdoc_threadpool_drain(YacDocThreadPool *pool) {
+    while (pool->next_task < pool->task_count) {
+        int index = pool->next_task++;
+        pthread_mutex_unlock(&pool->mutex);
+        pool->func(pool->ctx, index);
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->pending == 0) pthread_cond_broadcast(&pool->done_cond);
+    }
+}
+
+static void *yacdoc_threadpool_worker(void *arg) {
+    YacDocThreadPool *pool = arg;
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        while (!pool->is_shutdown && pool->next_task >= pool->task_count) {
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+        }
+        if (pool->is_shutdown) break;
+        yacdoc_threadpool_drain(pool);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+YacDocThreadPool *yacdoc_threadpool_new(int size) {
+    if (size <= 0) size = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (size <= 0) size = 1;
+    YacDocThreadPool *pool = malloc(sizeof(YacDocThreadPool));
+    assert(pool != NULL);
+    pool->size = size;
+    pool->func = NULL;
+    pool->ctx = NULL;
+    pool->task_count = 0;
+    pool->next_task = 0;
+    pool->pending = 0;
+    pool->is_shutdown = false;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    // The calling thread works too, so only size - 1 threads are spawned
+    pool->threads = malloc((size - 1 > 0 ? size - 1 : 1) * sizeof(pthread_t));
+    assert(pool->threads != NULL);
+    for (int i = 0; i < size - 1; i++) {
+        int result = pthread_create(&pool->threads[i], NULL, yacdoc_threadpool_worker, pool);
+        assert(result == 0);
+        (void) result;
+    }
+    return pool;
+}
+
+void yacdoc_threadpool_free(YacDocThreadPool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->is_shutdown = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->size - 1; i++) pthread_join(pool->threads[i], NULL);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->threads);
+    free(pool);
+}
+
+int yacdoc_threadpool_size(YacDocThreadPool *pool) {
+    return pool->size;
+}
+
+void yacdoc_threadpool_run(YacDocThreadPool *pool, YacDocThreadPoolTaskFunc func, void *ctx, int count) {
+    if (count <= 0) return;
+    pthread_mutex_lock(&pool->mutex);
+    pool->func = func;
+    pool->ctx = ctx;
+    pool->task_count = count;
+    pool->next_task = 0;
+    pool->pending = count;
+    pthread_cond_broadcast(&pool->work_cond);
+    yacdoc_threadpool_drain(pool);
+    while (pool->pending > 0) pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    pool->task_count = 0;
+    pool->next_task = 0;
+    pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,30 @@
+#ifndef YACDOC_THREADPOOL_H
+#define YACDOC_THREADPOOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+typedef void (* YacDocThreadPoolTaskFunc)(void *ctx, int index);
+
+// Fork-join pool: yacdoc_threadpool_run hands out task indexes to the workers
+// and to the calling thread, and returns once every task has finished
+typedef struct {
+    int size;
+    pthread_t *threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    YacDocThreadPoolTaskFunc func;
+    void *ctx;
+    int task_count;
+    int next_task;
+    int pending;
+    bool is_shutdown;
+} YacDocThreadPool;
+
+YacDocThreadPool *yacdoc_threadpool_new(int size);
+void yacdoc_threadpool_free(YacDocThreadPool *pool);
+int yacdoc_threadpool_size(YacDocThreadPool *pool);
+void yacdoc_threadpool_run(YacDocThreadPool *pool, YacDocThreadPoolTaskFunc func, void *ctx, int count);
+
+#endif
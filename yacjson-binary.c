@@ -0,0 +1,372 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "mapfile.h"
+#include "yacjson-binary.h"
+#include "yacjson-core.h"
+
+#define YACJSON_BINARY_MAGIC "YJSB"
+#define YACJSON_BINARY_VERSION (1)
+#define YACJSON_BINARY_ALIGN (8)
+#define YACJSON_BINARY_INITIAL_CAPACITY (4096)
+// Objects up to this size are searched linearly and get no sorted index
+#define YACJSON_BINARY_MAX_LINEAR_SIZE (8)
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} YacJSONBinaryBuffer;
+
+// Appends len zeroed bytes, padded to the alignment, and returns their offset;
+// offsets rather than pointers are kept while encoding since the buffer moves
+static size_t yacjson_binary_alloc(YacJSONBinaryBuffer *buffer, size_t len) {
+    size_t offset = buffer->len;
+    len = (len + YACJSON_BINARY_ALIGN - 1) & ~(size_t) (YACJSON_BINARY_ALIGN - 1);
+    if (buffer->capacity - buffer->len < len) {
+        while (buffer->capacity - buffer->len < len) buffer->capacity *= 2;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+        assert(buffer->data != NULL);
+    }
+    memset(buffer->data + offset, 0, len);
+    buffer->len += len;
+    return offset;
+}
+
+static YacJSONBinaryValue *yacjson_binary_slot(YacJSONBinaryBuffer *buffer, size_t offset) {
+    return (YacJSONBinaryValue *) (buffer->data + offset);
+}
+
+static const char *yacjson_binary_body(const YacJSONBinaryValue *value) {
+    return (const char *) value + value->data;
+}
+
+static int yacjson_binary_compare_keys(const char *a, size_t a_len, const char *b, size_t b_len) {
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp != 0) return cmp;
+    return a_len < b_len ? -1 : a_len > b_len;
+}
+
+static int yacjson_binary_compare_entries(const YacJSONBinaryEntry *entries, uint32_t a, uint32_t b) {
+    return yacjson_binary_compare_keys(yacjson_binary_entry_key(&entries[a]), entries[a].key_len,
+                                       yacjson_binary_entry_key(&entries[b]), entries[b].key_len);
+}
+
+// Merge sort of entry indexes by key, since qsort cannot be given the entries
+static void yacjson_binary_sort(const YacJSONBinaryEntry *entries, uint32_t *items, uint32_t *scratch, size_t count) {
+    if (count < 2) return;
+    size_t half = count / 2;
+    yacjson_binary_sort(entries, items, scratch, half);
+    yacjson_binary_sort(entries, items + half, scratch, count - half);
+    size_t left = 0, right = half, out = 0;
+    while (left < half && right < count) {
+        if (yacjson_binary_compare_entries(entries, items[right], items[left]) < 0) {
+            scratch[out++] = items[right++];
+        } else {
+            scratch[out++] = items[left++];
+        }
+    }
+    while (left < half) scratch[out++] = items[left++];
+    while (right < count) scratch[out++] = items[right++];
+    memcpy(items, scratch, count * sizeof(uint32_t));
+}
+
+static void yacjson_binary_encode_value(YacJSONBinaryBuffer *buffer, size_t slot, YacJSONValue *value);
+
+static void yacjson_binary_encode_string(YacJSONBinaryBuffer *buffer, size_t slot, YacJSONString *string) {
+    size_t body = yacjson_binary_alloc(buffer, string->len + 1);
+    size_t len = string->len;
+    memcpy(buffer->data + body, string->ptr, len);
+    // Raw strings are unescaped in the output, the tree is left untouched
+    if (string->is_raw) {
+        len = yacjson_string_unescape(buffer->data + body, len);
+        memset(buffer->data + body + len, 0, string->len - len);
+        buffer->len = body + ((len + YACJSON_BINARY_ALIGN) & ~(size_t) (YACJSON_BINARY_ALIGN - 1));
+    }
+    assert(len <= UINT32_MAX);
+    yacjson_binary_slot(buffer, slot)->size = (uint32_t) len;
+    yacjson_binary_slot(buffer, slot)->data = body - slot;
+}
+
+static void yacjson_binary_encode_object(YacJSONBinaryBuffer *buffer, size_t slot, YacJSONObject *object) {
+    size_t count = yacjson_object_size(object);
+    bool is_indexed = count > YACJSON_BINARY_MAX_LINEAR_SIZE;
+    size_t body = yacjson_binary_alloc(buffer, count * sizeof(YacJSONBinaryEntry) + (is_indexed ? count * sizeof(uint32_t) : 0));
+    yacjson_binary_slot(buffer, slot)->size = (uint32_t) count;
+    yacjson_binary_slot(buffer, slot)->data = body - slot;
+    YacJSONObjectItem *item;
+    YacJSONObjectIterator it;
+    yacjson_object_iterator_init(&it, object);
+    for (size_t i = 0; (item = yacjson_object_iterator_next(&it)) != NULL; i++) {
+        size_t entry = body + i * sizeof(YacJSONBinaryEntry);
+        const char *key = yacjson_object_item_key(item);
+        size_t key_len = strlen(key);
+        size_t key_offset = yacjson_binary_alloc(buffer, key_len + 1);
+        memcpy(buffer->data + key_offset, key, key_len);
+        ((YacJSONBinaryEntry *) (buffer->data + entry))->key = key_offset - entry;
+        ((YacJSONBinaryEntry *) (buffer->data + entry))->key_len = key_len;
+        yacjson_binary_encode_value(buffer, entry + offsetof(YacJSONBinaryEntry, value), yacjson_object_item_value(item));
+    }
+    if (!is_indexed) return;
+    const YacJSONBinaryEntry *entries = (const YacJSONBinaryEntry *) (buffer->data + body);
+    uint32_t *items = (uint32_t *) (buffer->data + body + count * sizeof(YacJSONBinaryEntry));
+    uint32_t *scratch = malloc(count * sizeof(uint32_t));
+    assert(scratch != NULL);
+    for (size_t i = 0; i < count; i++) items[i] = (uint32_t) i;
+    yacjson_binary_sort(entries, items, scratch, count);
+    free(scratch);
+}
+
+// Elements of packed arrays are encoded from the array's buffer so that the
+// tree is not boxed on the way
+static void yacjson_binary_encode_packed(YacJSONBinaryBuffer *buffer, size_t slot, YacJSONArray *array, int index) {
+    switch (yacjson_array_packing(array)) {
+        case YACJSON_ARRAY_INTEGERS:
+            yacjson_binary_slot(buffer, slot)->type = YACJSON_INTEGER;
+            yacjson_binary_slot(buffer, slot)->data = (uint64_t) yacjson_array_get_integer(array, index);
+            break;
+        case YACJSON_ARRAY_DECIMALS: {
+            double decimal = yacjson_array_get_decimal(array, index);
+            yacjson_binary_slot(buffer, slot)->type = YACJSON_DECIMAL;
+            memcpy(&yacjson_binary_slot(buffer, slot)->data, &decimal, sizeof(double));
+            break;
+        }
+        default:
+            yacjson_binary_slot(buffer, slot)->type = YACJSON_BOOLEAN;
+            yacjson_binary_slot(buffer, slot)->data = yacjson_array_get_boolean(array, index);
+            break;
+    }
+}
+
+static void yacjson_binary_encode_value(YacJSONBinaryBuffer *buffer, size_t slot, YacJSONValue *value) {
+    yacjson_binary_slot(buffer, slot)->type = value->type;
+    switch (value->type) {
+        case YACJSON_BOOLEAN:
+            yacjson_binary_slot(buffer, slot)->data = yacjson_value_to_boolean(value);
+            break;
+        case YACJSON_INTEGER:
+            yacjson_binary_slot(buffer, slot)->data = (uint64_t) yacjson_value_to_integer(value);
+            break;
+        case YACJSON_DECIMAL: {
+            double decimal = yacjson_value_to_decimal(value);
+            memcpy(&yacjson_binary_slot(buffer, slot)->data, &decimal, sizeof(double));
+            break;
+        }
+        case YACJSON_STRING:
+            yacjson_binary_encode_string(buffer, slot, &value->data.string);
+            break;
+        case YACJSON_ARRAY: {
+            YacJSONArray *array = yacjson_value_to_array(value);
+            size_t count = yacjson_array_size(array);
+            size_t body = yacjson_binary_alloc(buffer, count * sizeof(YacJSONBinaryValue));
+            yacjson_binary_slot(buffer, slot)->size = (uint32_t) count;
+            yacjson_binary_slot(buffer, slot)->data = body - slot;
+            if (yacjson_array_packing(array) != YACJSON_ARRAY_BOXED) {
+                for (size_t i = 0; i < count; i++) {
+                    yacjson_binary_encode_packed(buffer, body + i * sizeof(YacJSONBinaryValue), array, (int) i);
+                }
+                break;
+            }
+            for (size_t i = 0; i < count; i++) {
+                yacjson_binary_encode_value(buffer, body + i * sizeof(YacJSONBinaryValue), yacjson_array_get(array, (int) i));
+            }
+            break;
+        }
+        case YACJSON_OBJECT:
+            yacjson_binary_encode_object(buffer, slot, yacjson_value_to_object(value));
+            break;
+    }
+}
+
+char *yacjson_binary_encode(YacJSONValue *value, size_t *len) {
+    YacJSONBinaryBuffer buffer;
+    buffer.capacity = YACJSON_BINARY_INITIAL_CAPACITY;
+    buffer.data = malloc(buffer.capacity);
+    assert(buffer.data != NULL);
+    buffer.len = 0;
+    size_t header = yacjson_binary_alloc(&buffer, sizeof(YacJSONBinaryHeader));
+    yacjson_binary_encode_value(&buffer, header + offsetof(YacJSONBinaryHeader, root), value);
+    YacJSONBinaryHeader *head = (YacJSONBinaryHeader *) (buffer.data + header);
+    memcpy(head->magic, YACJSON_BINARY_MAGIC, sizeof(head->magic));
+    head->version = YACJSON_BINARY_VERSION;
+    head->len = buffer.len;
+    *len = buffer.len;
+    return buffer.data;
+}
+
+bool yacjson_binary_write(YacJSONValue *value, const char *filepath) {
+    size_t len;
+    char *data = yacjson_binary_encode(value, &len);
+    int fd = open(filepath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    bool is_written = fd != -1;
+    for (size_t done = 0; is_written && done < len;) {
+        ssize_t written = write(fd, data + done, len - done);
+        if (written < 0) {
+            is_written = errno == EINTR;
+            continue;
+        }
+        done += written;
+    }
+    if (fd != -1 && close(fd) != 0) is_written = false;
+    free(data);
+    return is_written;
+}
+
+static bool yacjson_binary_check_header(const char *data, size_t len) {
+    const YacJSONBinaryHeader *head = (const YacJSONBinaryHeader *) data;
+    if (len < sizeof(YacJSONBinaryHeader)) return false;
+    return !memcmp(head->magic, YACJSON_BINARY_MAGIC, sizeof(head->magic)) && head->version == YACJSON_BINARY_VERSION && head->len == len;
+}
+
+YacJSONBinaryDocument *yacjson_binary_document_open(const char *filepath) {
+    YacJSONBinaryDocument *doc = malloc(sizeof(YacJSONBinaryDocument));
+    assert(doc != NULL);
+    yacdoc_mapped_file_open(&doc->file, filepath);
+    doc->data = doc->file.data;
+    doc->len = doc->file.len;
+    if (!yacjson_binary_check_header(doc->data, doc->len)) {
+        yacjson_binary_document_free(doc);
+        return NULL;
+    }
+    return doc;
+}
+
+// Borrows data, which must be 8-byte aligned and outlive the document
+YacJSONBinaryDocument *yacjson_binary_document_from_buffer(const char *data, size_t len) {
+    assert((uintptr_t) data % YACJSON_BINARY_ALIGN == 0);
+    if (!yacjson_binary_check_header(data, len)) return NULL;
+    YacJSONBinaryDocument *doc = malloc(sizeof(YacJSONBinaryDocument));
+    assert(doc != NULL);
+    doc->file.data = NULL;
+    doc->file.len = 0;
+    doc->data = data;
+    doc->len = len;
+    return doc;
+}
+
+void yacjson_binary_document_free(YacJSONBinaryDocument *doc) {
+    yacdoc_mapped_file_close(&doc->file);
+    free(doc);
+}
+
+const YacJSONBinaryValue *yacjson_binary_document_root(YacJSONBinaryDocument *doc) {
+    return &((const YacJSONBinaryHeader *) doc->data)->root;
+}
+
+YacJSONValueType yacjson_binary_value_type(const YacJSONBinaryValue *value) {
+    return (YacJSONValueType) value->type;
+}
+
+// Copies the value into a heap tree to be released with yacjson_value_free
+YacJSONValue *yacjson_binary_value_to_tree(const YacJSONBinaryValue *value) {
+    switch (yacjson_binary_value_type(value)) {
+        case YACJSON_BOOLEAN:
+            return yacjson_value_from_boolean(yacjson_binary_value_to_boolean(value));
+        case YACJSON_INTEGER:
+            return yacjson_value_from_integer(yacjson_binary_value_to_integer(value));
+        case YACJSON_DECIMAL:
+            return yacjson_value_from_decimal(yacjson_binary_value_to_decimal(value));
+        case YACJSON_STRING:
+            return yacjson_value_from_string_length(yacjson_binary_value_to_string(value), value->size);
+        case YACJSON_ARRAY: {
+            YacJSONArray *array = yacjson_array_new();
+            yacdoc_arraylist_reserve(array, yacjson_binary_array_size(value));
+            for (int i = 0; i < yacjson_binary_array_size(value); i++) {
+                yacjson_array_add(array, yacjson_binary_value_to_tree(yacjson_binary_array_get(value, i)));
+            }
+            return yacjson_value_from_array(array);
+        }
+        case YACJSON_OBJECT: {
+            YacJSONObject *object = yacjson_object_new();
+            for (int i = 0; i < yacjson_binary_object_size(value); i++) {
+                const YacJSONBinaryEntry *entry = yacjson_binary_object_entry(value, i);
+                yacjson_object_add(object, (char *) yacjson_binary_entry_key(entry), yacjson_binary_value_to_tree(&entry->value));
+            }
+            return yacjson_value_from_object(object);
+        }
+    }
+    return NULL;
+}
+
+bool yacjson_binary_value_to_boolean(const YacJSONBinaryValue *value) {
+    return value->data != 0;
+}
+
+long yacjson_binary_value_to_integer(const YacJSONBinaryValue *value) {
+    return (long) value->data;
+}
+
+double yacjson_binary_value_to_decimal(const YacJSONBinaryValue *value) {
+    double decimal;
+    memcpy(&decimal, &value->data, sizeof(double));
+    return decimal;
+}
+
+const char *yacjson_binary_value_to_string(const YacJSONBinaryValue *value) {
+    return yacjson_binary_body(value);
+}
+
+size_t yacjson_binary_value_string_length(const YacJSONBinaryValue *value) {
+    return value->size;
+}
+
+int yacjson_binary_object_size(const YacJSONBinaryValue *object) {
+    return (int) object->size;
+}
+
+int yacjson_binary_array_size(const YacJSONBinaryValue *array) {
+    return (int) array->size;
+}
+
+const YacJSONBinaryEntry *yacjson_binary_object_entry(const YacJSONBinaryValue *object, int index) {
+    if (index < 0 || (uint32_t) index >= object->size) return NULL;
+    return (const YacJSONBinaryEntry *) yacjson_binary_body(object) + index;
+}
+
+const char *yacjson_binary_entry_key(const YacJSONBinaryEntry *entry) {
+    return (const char *) entry + entry->key;
+}
+
+const YacJSONBinaryValue *yacjson_binary_entry_value(const YacJSONBinaryEntry *entry) {
+    return &entry->value;
+}
+
+const YacJSONBinaryValue *yacjson_binary_object_get(const YacJSONBinaryValue *object, const char *key) {
+    const YacJSONBinaryEntry *entries = (const YacJSONBinaryEntry *) yacjson_binary_body(object);
+    size_t len = strlen(key);
+    if (object->size <= YACJSON_BINARY_MAX_LINEAR_SIZE) {
+        for (uint32_t i = 0; i < object->size; i++) {
+            if (entries[i].key_len == len && !memcmp(yacjson_binary_entry_key(&entries[i]), key, len)) return &entries[i].value;
+        }
+        return NULL;
+    }
+    const uint32_t *items = (const uint32_t *) (entries + object->size);
+    size_t low = 0, high = object->size;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const YacJSONBinaryEntry *entry = &entries[items[mid]];
+        int cmp = yacjson_binary_compare_keys(yacjson_binary_entry_key(entry), entry->key_len, key, len);
+        if (cmp == 0) return &entry->value;
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return NULL;
+}
+
+const YacJSONBinaryValue *yacjson_binary_array_get(const YacJSONBinaryValue *array, int index) {
+    if (index < 0 || (uint32_t) index >= array->size) return NULL;
+    return (const YacJSONBinaryValue *) yacjson_binary_body(array) + index;
+}
@@ -0,0 +1,78 @@
+#ifndef YACJSON_BINARY_H
+#define YACJSON_BINARY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mapfile.h"
+#include "yacjson-core.h"
+
+// yacdoc binary format, version 1. Everything is in native byte order and
+// 8-byte aligned, so a file can be used straight from an mmap: a value is a
+// pointer to its 16-byte slot in the file and no nodes are ever allocated.
+//
+//   header    "YJSB", uint32 version, uint64 total length, root slot
+//   slot      uint32 type, uint32 size, uint64 data
+//   entry     uint64 key offset, uint64 key length, slot
+//
+// Booleans, integers and decimals (as raw bits) live in the slot data. For
+// strings, arrays and objects the data is the offset from the slot to the body
+// and size is the byte length or member count. String bodies are the unescaped
+// bytes followed by a NUL; array bodies are their element slots; object bodies
+// are their entries in iteration order, followed for objects of more than 8
+// members by uint32 entry indexes sorted by key for binary search. Key offsets
+// are relative to the entry, keys are NUL-terminated and unescaped like in the
+// tree
+typedef struct {
+    uint32_t type;
+    uint32_t size;
+    uint64_t data;
+} YacJSONBinaryValue;
+
+typedef struct {
+    uint64_t key;
+    uint64_t key_len;
+    YacJSONBinaryValue value;
+} YacJSONBinaryEntry;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t len;
+    YacJSONBinaryValue root;
+} YacJSONBinaryHeader;
+
+// Only the header is checked when opening, the contents are trusted to come
+// from yacjson_binary_encode
+typedef struct {
+    YacDocMappedFile file;
+    const char *data;
+    size_t len;
+} YacJSONBinaryDocument;
+
+char *yacjson_binary_encode(YacJSONValue *value, size_t *len);
+bool yacjson_binary_write(YacJSONValue *value, const char *filepath);
+
+YacJSONBinaryDocument *yacjson_binary_document_open(const char *filepath);
+YacJSONBinaryDocument *yacjson_binary_document_from_buffer(const char *data, size_t len);
+void yacjson_binary_document_free(YacJSONBinaryDocument *doc);
+const YacJSONBinaryValue *yacjson_binary_document_root(YacJSONBinaryDocument *doc);
+
+YacJSONValueType yacjson_binary_value_type(const YacJSONBinaryValue *value);
+YacJSONValue *yacjson_binary_value_to_tree(const YacJSONBinaryValue *value);
+bool yacjson_binary_value_to_boolean(const YacJSONBinaryValue *value);
+long yacjson_binary_value_to_integer(const YacJSONBinaryValue *value);
+double yacjson_binary_value_to_decimal(const YacJSONBinaryValue *value);
+const char *yacjson_binary_value_to_string(const YacJSONBinaryValue *value);
+size_t yacjson_binary_value_string_length(const YacJSONBinaryValue *value);
+
+int yacjson_binary_object_size(const YacJSONBinaryValue *object);
+int yacjson_binary_array_size(const YacJSONBinaryValue *array);
+const YacJSONBinaryEntry *yacjson_binary_object_entry(const YacJSONBinaryValue *object, int index);
+const char *yacjson_binary_entry_key(const YacJSONBinaryEntry *entry);
+const YacJSONBinaryValue *yacjson_binary_entry_value(const YacJSONBinaryEntry *entry);
+const YacJSONBinaryValue *yacjson_binary_object_get(const YacJSONBinaryValue *object, const char *key);
+const YacJSONBinaryValue *yacjson_binary_array_get(const YacJSONBinaryValue *array, int index);
+
+#endif
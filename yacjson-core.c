@@ -1,12 +1,29 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
 
+#include "mapfile.h"
+#include "threadpool.h"
 #include "yacjson-core.h"
+#include "yacjson-number.h"
+#include "yacjson-push.h"
+#include "yacjson-sax.h"
+
+#define YACJSON_WRITER_INITIAL_CAPACITY (256)
+#define YACJSON_WRITER_FD_CAPACITY (64 * 1024)
+#define YACJSON_WRITER_MAX_INDENT (256)
+#define YACJSON_SERIALIZE_CHUNKS_PER_THREAD (4)
+#define YACJSON_SERIALIZE_MIN_PARALLEL_COUNT (1024)
+#define YACJSON_ARRAY_PACKED_INITIAL_CAPACITY (8)
 
-#define YACJSON_MAX_BUFFER_LEN (256)
 
 YacJSONObject *yacjson_object_new() {
     return yacdoc_hashmap_new();
@@ -16,35 +33,50 @@ YacJSONArray *yacjson_array_new() {
     return yacdoc_arraylist_new();
 }
 
-static void yacjson_value_free_void(void *value) {
+YacJSONObject *yacjson_object_new_with(const YacDocAllocator *allocator) {
+    return yacdoc_hashmap_new_with(allocator);
+}
+
+YacJSONArray *yacjson_array_new_with(const YacDocAllocator *allocator) {
+    return yacdoc_arraylist_new_with(allocator);
+}
+
+static void yacjson_value_free_void(void *value, const YacDocAllocator *allocator) {
     if (yacjson_value_is_string(value)) {
-        free(yacjson_value_to_string(value));
+        yacdoc_free(allocator, ((YacJSONValue *) value)->data.string.ptr);
     } else if (yacjson_value_is_object(value)) {
         yacdoc_hashmap_free(yacjson_value_to_object(value), yacjson_value_free_void);
     } else if (yacjson_value_is_array(value)) {
         yacdoc_arraylist_free(yacjson_value_to_array(value), yacjson_value_free_void);
     }
-    free(value);
+    yacdoc_free(allocator, value);
 }
 
+// Values inside a container come from the container's allocator, which is
+// also where objects and arrays put the value holding them
 void yacjson_value_free(YacJSONValue *value) {
-    yacjson_value_free_void((void *) value);
+    const YacDocAllocator *allocator = NULL;
+    if (yacjson_value_is_object(value)) {
+        allocator = yacjson_value_to_object(value)->allocator;
+    } else if (yacjson_value_is_array(value)) {
+        allocator = yacjson_value_to_array(value)->allocator;
+    }
+    yacjson_value_free_void(value, allocator);
 }
 
-YacJSONObjectIterator *yacjson_object_iterator_new(YacJSONObject *object) {
-    return yacdoc_hashmap_iterator_new(object);
+void yacjson_value_free_with(YacJSONValue *value, const YacDocAllocator *allocator) {
+    yacjson_value_free_void(value, allocator);
 }
 
-YacJSONArrayIterator *yacjson_array_iterator_new(YacJSONArray *array) {
-    return yacdoc_arraylist_iterator_new(array);
+void yacjson_object_iterator_init(YacJSONObjectIterator *it, YacJSONObject *object) {
+    yacdoc_hashmap_iterator_init(it, object);
 }
 
-void yacjson_object_iterator_free(YacJSONObjectIterator *it) {
-    yacdoc_hashmap_iterator_free(it);
-}
+static void yacjson_array_unpack(YacJSONArray *array);
 
-void yacjson_array_iterator_free(YacJSONArrayIterator *it) {
-    yacdoc_arraylist_iterator_free(it);
+void yacjson_array_iterator_init(YacJSONArrayIterator *it, YacJSONArray *array) {
+    yacjson_array_unpack(array);
+    yacdoc_arraylist_iterator_init(it, array);
 }
 
 YacJSONObjectItem *yacjson_object_iterator_next(YacJSONObjectIterator *it) {
@@ -120,57 +152,346 @@ double yacjson_value_to_decimal(YacJSONValue *value) {
 }
 
 char *yacjson_value_to_string(YacJSONValue *value) {
-    return value->data.string;
+    YacJSONString *string = &value->data.string;
+    if (string->is_raw) {
+        string->len = yacjson_string_unescape(string->ptr, string->len);
+        string->ptr[string->len] = '\0';
+        string->is_raw = false;
+    }
+    return string->ptr;
+}
+
+// Unescaped strings may hold NUL bytes from \u0000, so the length is kept
+size_t yacjson_value_string_length(YacJSONValue *value) {
+    yacjson_value_to_string(value);
+    return value->data.string.len;
+}
+
+// Packed arrays hold no strings, so they are left as they are
+void yacjson_value_resolve_strings(YacJSONValue *value) {
+    if (yacjson_value_is_string(value)) {
+        yacjson_value_to_string(value);
+    } else if (yacjson_value_is_object(value)) {
+        YacJSONObject *object = yacjson_value_to_object(value);
+        for (int i = 0; i < object->size; i++) yacjson_value_resolve_strings(object->items[i].value);
+    } else if (yacjson_value_is_array(value)) {
+        YacJSONArray *array = yacjson_value_to_array(value);
+        if (array->packed_kind != YACJSON_ARRAY_BOXED) return;
+        for (int i = 0; i < array->size; i++) yacjson_value_resolve_strings(array->items[i].value);
+    }
+}
+
+static int yacjson_hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static long yacjson_hex_code(const char *ptr, const char *end) {
+    long code = 0;
+    if (end - ptr < 4) return -1;
+    for (int i = 0; i < 4; i++) {
+        int digit = yacjson_hex_digit(ptr[i]);
+        if (digit < 0) return -1;
+        code = code << 4 | digit;
+    }
+    return code;
+}
+
+static char *yacjson_write_utf8(char *out, long code) {
+    if (code < 0x80) {
+        *out++ = (char) code;
+    } else if (code < 0x800) {
+        *out++ = (char) (0xC0 | code >> 6);
+        *out++ = (char) (0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        *out++ = (char) (0xE0 | code >> 12);
+        *out++ = (char) (0x80 | (code >> 6 & 0x3F));
+        *out++ = (char) (0x80 | (code & 0x3F));
+    } else {
+        *out++ = (char) (0xF0 | code >> 18);
+        *out++ = (char) (0x80 | (code >> 12 & 0x3F));
+        *out++ = (char) (0x80 | (code >> 6 & 0x3F));
+        *out++ = (char) (0x80 | (code & 0x3F));
+    }
+    return out;
+}
+
+// Resolves escape sequences in place and returns the new length, which is never
+// longer than the old one. Malformed escapes are kept verbatim
+size_t yacjson_string_unescape(char *data, size_t len) {
+    char *end = data + len;
+    char *read = memchr(data, '\\', len);
+    if (read == NULL) return len;
+    char *write = read;
+    while (read < end) {
+        char *next = memchr(read, '\\', end - read);
+        if (next == NULL) next = end;
+        memmove(write, read, next - read);
+        write += next - read;
+        read = next;
+        if (read == end || read + 1 == end) break;
+        char escaped = '\0';
+        switch (read[1]) {
+            case '"':
+            case '\\':
+            case '/':
+                escaped = read[1];
+                break;
+            case 'b':
+                escaped = '\b';
+                break;
+            case 'f':
+                escaped = '\f';
+                break;
+            case 'n':
+                escaped = '\n';
+                break;
+            case 'r':
+                escaped = '\r';
+                break;
+            case 't':
+                escaped = '\t';
+                break;
+            case 'u': {
+                long code = yacjson_hex_code(read + 2, end);
+                if (code < 0) break;
+                read += 6;
+                // A high surrogate followed by a low one encodes a single code
+                // point; lone surrogates are written as they are
+                if (code >= 0xD800 && code < 0xDC00 && end - read >= 6 && read[0] == '\\' && read[1] == 'u') {
+                    long low = yacjson_hex_code(read + 2, end);
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        read += 6;
+                    }
+                }
+                write = yacjson_write_utf8(write, code);
+                continue;
+            }
+        }
+        if (escaped != '\0') {
+            *write++ = escaped;
+            read += 2;
+        } else {
+            *write++ = *read++;
+        }
+    }
+    memmove(write, read, end - read);
+    write += end - read;
+    return write - data;
+}
+
+// Keys are handed out by the SAX layer still escaped but are stored and looked
+// up unescaped. NULL means key has no escapes, which is nearly always, and is
+// fine as it is; otherwise the unescaped copy is returned, with len updated,
+// for the caller to free
+char *yacjson_key_unescape(const char *key, size_t *len) {
+    if (memchr(key, '\\', *len) == NULL) return NULL;
+    char *unescaped = malloc(*len + 1);
+    assert(unescaped != NULL);
+    memcpy(unescaped, key, *len);
+    *len = yacjson_string_unescape(unescaped, *len);
+    unescaped[*len] = '\0';
+    return unescaped;
+}
+
+static YacJSONValue *yacjson_value_new(const YacDocAllocator *allocator, YacJSONValueType type) {
+    YacJSONValue *value = yacdoc_alloc(allocator, sizeof(YacJSONValue));
+    value->type = type;
+    return value;
+}
+
+static YacJSONValue *yacjson_value_from_buffer(const YacDocAllocator *allocator, const char *start, size_t len, bool is_raw) {
+    YacJSONValue *value = yacjson_value_new(allocator, YACJSON_STRING);
+    value->data.string.len = len;
+    value->data.string.is_raw = is_raw;
+    value->data.string.ptr = yacdoc_alloc(allocator, len + 1);
+    memcpy(value->data.string.ptr, start, len);
+    value->data.string.ptr[len] = '\0';
+    return value;
 }
 
 YacJSONValue *yacjson_value_from_object(YacJSONObject *object) {
-    YacJSONValue *value = malloc(sizeof(YacJSONValue));
-    assert(value != NULL);
-    value->type = YACJSON_OBJECT;
+    YacJSONValue *value = yacjson_value_new(object->allocator, YACJSON_OBJECT);
     value->data.object = object;
     return value;
 }
 
 YacJSONValue *yacjson_value_from_array(YacJSONArray *array) {
-    YacJSONValue *value = malloc(sizeof(YacJSONValue));
-    assert(value != NULL);
-    value->type = YACJSON_ARRAY;
+    YacJSONValue *value = yacjson_value_new(array->allocator, YACJSON_ARRAY);
     value->data.array = array;
     return value;
 }
 
 YacJSONValue *yacjson_value_from_boolean(bool boolean) {
-    YacJSONValue *value = malloc(sizeof(YacJSONValue));
-    assert(value != NULL);
-    value->type = YACJSON_BOOLEAN;
+    YacJSONValue *value = yacjson_value_new(NULL, YACJSON_BOOLEAN);
     value->data.boolean = boolean;
     return value;
 }
 
 YacJSONValue *yacjson_value_from_integer(long integer) {
-    YacJSONValue *value = malloc(sizeof(YacJSONValue));
-    assert(value != NULL);
-    value->type = YACJSON_INTEGER;
+    YacJSONValue *value = yacjson_value_new(NULL, YACJSON_INTEGER);
     value->data.integer = integer;
     return value;
 }
 
 YacJSONValue *yacjson_value_from_decimal(double decimal) {
-    YacJSONValue *value = malloc(sizeof(YacJSONValue));
-    assert(value != NULL);
-    value->type = YACJSON_DECIMAL;
+    YacJSONValue *value = yacjson_value_new(NULL, YACJSON_DECIMAL);
     value->data.decimal = decimal;
     return value;
 }
 
 YacJSONValue *yacjson_value_from_string(char *string) {
-    YacJSONValue *value = malloc(sizeof(YacJSONValue));
-    assert(value != NULL);
-    value->type = YACJSON_STRING;
-    value->data.string = malloc(strlen(string) + 1);
-    assert(value->data.string != NULL);
-    strcpy(value->data.string, string);
-    return value;
+    return yacjson_value_from_buffer(NULL, string, strlen(string), false);
+}
+
+// For strings that may hold NUL characters
+YacJSONValue *yacjson_value_from_string_length(const char *string, size_t len) {
+    return yacjson_value_from_buffer(NULL, string, len, false);
+}
+
+// Where the text of a container sits in the last output of a serialize cache.
+// offset counts from the start of the parent's text, so the records inside a
+// subtree copied as is stay valid wherever the subtree lands
+typedef struct YacJSONCacheRecord {
+    struct YacJSONCacheRecord *parent;
+    size_t offset;
+    size_t len;
+    bool is_dirty;
+} YacJSONCacheRecord;
+
+// Dirtying a container dirties every container above it, so that an update
+// walks down exactly the paths that changed
+static void yacjson_cache_mark_dirty(YacJSONCacheRecord *record) {
+    for (; record != NULL && !record->is_dirty; record = record->parent) record->is_dirty = true;
+}
+
+void yacjson_object_mark_dirty(YacJSONObject *object) {
+    yacjson_cache_mark_dirty(object->cache);
+}
+
+void yacjson_array_mark_dirty(YacJSONArray *array) {
+    yacjson_cache_mark_dirty(array->cache);
+}
+
+static size_t yacjson_array_packed_bytes(YacJSONArrayPacking packing, int count) {
+    switch (packing) {
+        case YACJSON_ARRAY_INTEGERS:
+            return count * sizeof(long);
+        case YACJSON_ARRAY_DECIMALS:
+            return count * sizeof(double);
+        case YACJSON_ARRAY_BOOLEANS:
+            return (count + 63) / 64 * sizeof(uint64_t);
+        default:
+            return 0;
+    }
+}
+
+// Makes room for one more element stored unboxed with the given packing, which
+// only an empty array or one already packed the same way can take
+static bool yacjson_array_reserve_packed(YacJSONArray *array, YacJSONArrayPacking packing) {
+    if ((YacJSONArrayPacking) array->packed_kind != packing) {
+        if (array->packed_kind != YACJSON_ARRAY_BOXED || array->size > 0 || array->items != NULL) return false;
+        array->packed_kind = packing;
+        array->capacity = 0;
+    }
+    if (array->size == array->capacity) {
+        int capacity = array->capacity == 0 ? YACJSON_ARRAY_PACKED_INITIAL_CAPACITY : array->capacity * 2;
+        array->packed = yacdoc_realloc(array->allocator, array->packed, yacjson_array_packed_bytes(packing, array->capacity), yacjson_array_packed_bytes(packing, capacity));
+        array->capacity = capacity;
+    }
+    return true;
+}
+
+static bool yacjson_array_bit(const uint64_t *bits, int index) {
+    return (bits[index / 64] >> (index % 64)) & 1;
+}
+
+// Turns a packed array back into a list of values, which is what element
+// pointers and iterators need. Like the unescaping of strings it happens on
+// first access and writes to the tree
+static void yacjson_array_unpack(YacJSONArray *array) {
+    YacJSONArrayPacking packing = array->packed_kind;
+    if (packing == YACJSON_ARRAY_BOXED) return;
+    void *packed = array->packed;
+    int count = array->size;
+    array->packed_kind = YACJSON_ARRAY_BOXED;
+    array->packed = NULL;
+    array->size = 0;
+    array->capacity = 0;
+    yacdoc_arraylist_reserve(array, count);
+    for (int i = 0; i < count; i++) {
+        YacJSONValue *value;
+        if (packing == YACJSON_ARRAY_INTEGERS) {
+            value = yacjson_value_new(array->allocator, YACJSON_INTEGER);
+            value->data.integer = ((long *) packed)[i];
+        } else if (packing == YACJSON_ARRAY_DECIMALS) {
+            value = yacjson_value_new(array->allocator, YACJSON_DECIMAL);
+            value->data.decimal = ((double *) packed)[i];
+        } else {
+            value = yacjson_value_new(array->allocator, YACJSON_BOOLEAN);
+            value->data.boolean = yacjson_array_bit(packed, i);
+        }
+        yacdoc_arraylist_add(array, value);
+    }
+    yacdoc_free(array->allocator, packed);
+}
+
+YacJSONArrayPacking yacjson_array_packing(YacJSONArray *array) {
+    return array->packed_kind;
+}
+
+long *yacjson_array_as_longs(YacJSONArray *array) {
+    return array->packed_kind == YACJSON_ARRAY_INTEGERS ? array->packed : NULL;
+}
+
+double *yacjson_array_as_doubles(YacJSONArray *array) {
+    return array->packed_kind == YACJSON_ARRAY_DECIMALS ? array->packed : NULL;
+}
+
+uint64_t *yacjson_array_as_bits(YacJSONArray *array) {
+    return array->packed_kind == YACJSON_ARRAY_BOOLEANS ? array->packed : NULL;
+}
+
+// The packed buffer comes from the array's allocator, like the buffers that
+// packing while parsing grows, so that unpacking and freeing release it there
+static YacJSONArray *yacjson_array_from_packed(const YacDocAllocator *allocator, YacJSONArrayPacking packing, const void *values, int count) {
+    YacJSONArray *array = yacjson_array_new_with(allocator);
+    if (count == 0) return array;
+    array->packed_kind = packing;
+    array->packed = yacdoc_alloc(allocator, yacjson_array_packed_bytes(packing, count));
+    memcpy(array->packed, values, yacjson_array_packed_bytes(packing, count));
+    array->size = count;
+    array->capacity = count;
+    return array;
+}
+
+YacJSONArray *yacjson_array_from_longs(const long *values, int count) {
+    return yacjson_array_from_longs_with(values, count, NULL);
+}
+
+YacJSONArray *yacjson_array_from_doubles(const double *values, int count) {
+    return yacjson_array_from_doubles_with(values, count, NULL);
+}
+
+YacJSONArray *yacjson_array_from_booleans(const bool *values, int count) {
+    return yacjson_array_from_booleans_with(values, count, NULL);
+}
+
+YacJSONArray *yacjson_array_from_longs_with(const long *values, int count, const YacDocAllocator *allocator) {
+    return yacjson_array_from_packed(allocator, YACJSON_ARRAY_INTEGERS, values, count);
+}
+
+YacJSONArray *yacjson_array_from_doubles_with(const double *values, int count, const YacDocAllocator *allocator) {
+    return yacjson_array_from_packed(allocator, YACJSON_ARRAY_DECIMALS, values, count);
+}
+
+YacJSONArray *yacjson_array_from_booleans_with(const bool *values, int count, const YacDocAllocator *allocator) {
+    YacJSONArray *array = yacjson_array_new_with(allocator);
+    for (int i = 0; i < count; i++) yacjson_array_add_boolean(array, values[i]);
+    return array;
 }
 
 int yacjson_object_size(YacJSONObject *object) {
@@ -182,59 +503,100 @@ int yacjson_array_size(YacJSONArray *array) {
 }
 
 void yacjson_object_add(YacJSONObject *object, char *key, YacJSONValue *value) {
+    yacjson_object_mark_dirty(object);
     yacdoc_hashmap_add(object, key, (void *) value);
 }
 
 void yacjson_array_add(YacJSONArray *array, YacJSONValue *value) {
+    yacjson_array_mark_dirty(array);
+    yacjson_array_unpack(array);
     yacdoc_arraylist_add(array, (void *) value);
 }
 
 void yacjson_object_add_object(YacJSONObject *object, char *key, YacJSONObject *value_object) {
-    yacjson_object_add(object, key, yacjson_value_from_object(value_object));
+    YacJSONValue *value = yacjson_value_new(object->allocator, YACJSON_OBJECT);
+    value->data.object = value_object;
+    yacjson_object_add(object, key, value);
 }
 
 void yacjson_object_add_array(YacJSONObject *object, char *key, YacJSONArray *value_array) {
-    yacjson_object_add(object, key, yacjson_value_from_array(value_array));
+    YacJSONValue *value = yacjson_value_new(object->allocator, YACJSON_ARRAY);
+    value->data.array = value_array;
+    yacjson_object_add(object, key, value);
 }
 
 void yacjson_object_add_boolean(YacJSONObject *object, char *key, bool value_boolean) {
-    yacjson_object_add(object, key, yacjson_value_from_boolean(value_boolean));
+    YacJSONValue *value = yacjson_value_new(object->allocator, YACJSON_BOOLEAN);
+    value->data.boolean = value_boolean;
+    yacjson_object_add(object, key, value);
 }
 
 void yacjson_object_add_integer(YacJSONObject *object, char *key, long value_integer) {
-    yacjson_object_add(object, key, yacjson_value_from_integer(value_integer));
+    YacJSONValue *value = yacjson_value_new(object->allocator, YACJSON_INTEGER);
+    value->data.integer = value_integer;
+    yacjson_object_add(object, key, value);
 }
 
 void yacjson_object_add_decimal(YacJSONObject *object, char *key, double value_decimal) {
-    yacjson_object_add(object, key, yacjson_value_from_decimal(value_decimal));
+    YacJSONValue *value = yacjson_value_new(object->allocator, YACJSON_DECIMAL);
+    value->data.decimal = value_decimal;
+    yacjson_object_add(object, key, value);
 }
 
 void yacjson_object_add_string(YacJSONObject *object, char *key, char *value_string) {
-    yacjson_object_add(object, key, yacjson_value_from_string(value_string));
+    yacjson_object_add(object, key, yacjson_value_from_buffer(object->allocator, value_string, strlen(value_string), false));
 }
 
 void yacjson_array_add_object(YacJSONArray *array, YacJSONObject *value_object) {
-    yacjson_array_add(array, yacjson_value_from_object(value_object));
+    YacJSONValue *value = yacjson_value_new(array->allocator, YACJSON_OBJECT);
+    value->data.object = value_object;
+    yacjson_array_add(array, value);
 }
 
 void yacjson_array_add_array(YacJSONArray *array, YacJSONArray *value_array) {
-    yacjson_array_add(array, yacjson_value_from_array(value_array));
+    YacJSONValue *value = yacjson_value_new(array->allocator, YACJSON_ARRAY);
+    value->data.array = value_array;
+    yacjson_array_add(array, value);
 }
 
 void yacjson_array_add_boolean(YacJSONArray *array, bool value_boolean) {
-    yacjson_array_add(array, yacjson_value_from_boolean(value_boolean));
+    yacjson_array_mark_dirty(array);
+    if (yacjson_array_reserve_packed(array, YACJSON_ARRAY_BOOLEANS)) {
+        uint64_t *word = &((uint64_t *) array->packed)[array->size / 64];
+        uint64_t bit = (uint64_t) 1 << (array->size % 64);
+        *word = value_boolean ? *word | bit : *word & ~bit;
+        array->size++;
+        return;
+    }
+    YacJSONValue *value = yacjson_value_new(array->allocator, YACJSON_BOOLEAN);
+    value->data.boolean = value_boolean;
+    yacjson_array_add(array, value);
 }
 
 void yacjson_array_add_integer(YacJSONArray *array, long value_integer) {
-    yacjson_array_add(array, yacjson_value_from_integer(value_integer));
+    yacjson_array_mark_dirty(array);
+    if (yacjson_array_reserve_packed(array, YACJSON_ARRAY_INTEGERS)) {
+        ((long *) array->packed)[array->size++] = value_integer;
+        return;
+    }
+    YacJSONValue *value = yacjson_value_new(array->allocator, YACJSON_INTEGER);
+    value->data.integer = value_integer;
+    yacjson_array_add(array, value);
 }
 
 void yacjson_array_add_decimal(YacJSONArray *array, double value_decimal) {
-    yacjson_array_add(array, yacjson_value_from_decimal(value_decimal));
+    yacjson_array_mark_dirty(array);
+    if (yacjson_array_reserve_packed(array, YACJSON_ARRAY_DECIMALS)) {
+        ((double *) array->packed)[array->size++] = value_decimal;
+        return;
+    }
+    YacJSONValue *value = yacjson_value_new(array->allocator, YACJSON_DECIMAL);
+    value->data.decimal = value_decimal;
+    yacjson_array_add(array, value);
 }
 
 void yacjson_array_add_string(YacJSONArray *array, char *value_string) {
-    yacjson_array_add(array, yacjson_value_from_string(value_string));
+    yacjson_array_add(array, yacjson_value_from_buffer(array->allocator, value_string, strlen(value_string), false));
 }
 
 YacJSONValue *yacjson_object_get(YacJSONObject *object, const char *key) {
@@ -242,6 +604,7 @@ YacJSONValue *yacjson_object_get(YacJSONObject *object, const char *key) {
 }
 
 YacJSONValue *yacjson_array_get(YacJSONArray *array, int index) {
+    yacjson_array_unpack(array);
     return yacdoc_arraylist_get(array, index);
 }
 
@@ -278,14 +641,17 @@ YacJSONArray *yacjson_array_get_array(YacJSONArray *array, int index) {
 }
 
 bool yacjson_array_get_boolean(YacJSONArray *array, int index) {
+    if (array->packed_kind == YACJSON_ARRAY_BOOLEANS) return yacjson_array_bit(array->packed, index);
     return yacjson_value_to_boolean(yacjson_array_get(array, index));
 }
 
 long yacjson_array_get_integer(YacJSONArray *array, int index) {
+    if (array->packed_kind == YACJSON_ARRAY_INTEGERS) return ((long *) array->packed)[index];
     return yacjson_value_to_integer(yacjson_array_get(array, index));
 }
 
 double yacjson_array_get_decimal(YacJSONArray *array, int index) {
+    if (array->packed_kind == YACJSON_ARRAY_DECIMALS) return ((double *) array->packed)[index];
     return yacjson_value_to_decimal(yacjson_array_get(array, index));
 }
 
@@ -293,208 +659,880 @@ char *yacjson_array_get_string(YacJSONArray *array, int index) {
     return yacjson_value_to_string(yacjson_array_get(array, index));
 }
 
-static YacJSONValue *yacjson_parse_primitive_from_string(char *value_string) {
-    if (!strcmp(value_string, "true")) return yacjson_value_from_boolean(true);
-    if (!strcmp(value_string, "false")) return yacjson_value_from_boolean(false);
-    char *end_ptr;
-    long value_integer = strtol(value_string, &end_ptr, 10);
-    if (*end_ptr == '\0')
-        return yacjson_value_from_integer(value_integer);
-    double value_decimal = strtod(value_string, &end_ptr);
-    if (*end_ptr == '\0')
-        return yacjson_value_from_decimal(value_decimal);
-    return yacjson_value_from_string(strtok(value_string, "\""));
-}
-
-static YacJSONValue *yacjson_parse_object_from_file(FILE *file);
-static YacJSONValue *yacjson_parse_array_from_file(FILE *file);
-
-// TODO: Use separate loops instead of is_key_added and is_value_added
-
-static YacJSONValue *yacjson_parse_object_from_file(FILE *file) {
-    YacJSONObject *object = yacjson_object_new();
-    int ch, pos = 0;
-    static char buffer[YACJSON_MAX_BUFFER_LEN];
-    char key[YACJSON_MAX_BUFFER_LEN];
-    bool is_quoted = false;
-    bool is_key_added = false;
-    bool is_value_added = false;
-    while ((ch = fgetc(file)) != EOF) {
-        if (ch == '"') {
-            is_quoted = !is_quoted || buffer[pos - 1] == '\\';
-        }
-        if (!is_quoted && !is_key_added) {
-            switch (ch) {
-                case ' ':
-                case '\n':
-                case '\t':
-                    continue;
-                case ':':
-                    buffer[pos] = '\0';
-                    strcpy(key, strtok(buffer, "\""));
-                    pos = 0;
-                    is_key_added = true;
-                    continue;
-            }
+struct YacJSONTreeBuilder {
+    const YacDocAllocator *allocator;
+    bool is_insitu;
+    YacJSONValue *root;
+    YacJSONValue **stack;
+    int depth;
+    int capacity;
+    char *key;
+    YacDocKeyTable *keys;
+};
+
+// Returns false when the value is dropped because its key is a duplicate; the
+// first occurrence of a key wins and later ones are released right away
+static bool yacjson_tree_builder_attach(YacJSONTreeBuilder *builder, YacJSONValue *value) {
+    if (builder->depth == 0) {
+        builder->root = value;
+        return true;
+    }
+    YacJSONValue *parent = builder->stack[builder->depth - 1];
+    if (yacjson_value_is_array(parent)) {
+        yacjson_array_add(yacjson_value_to_array(parent), value);
+        return true;
+    }
+    if (yacdoc_hashmap_add_interned(yacjson_value_to_object(parent), builder->key, value)) return true;
+    yacjson_value_free_void(value, builder->allocator);
+    return false;
+}
+
+static YacJSONSaxAction yacjson_tree_builder_push(YacJSONTreeBuilder *builder, YacJSONValue *value) {
+    if (!yacjson_tree_builder_attach(builder, value)) return YACJSON_SAX_SKIP;
+    if (builder->depth == builder->capacity) {
+        builder->capacity = builder->capacity == 0 ? 16 : builder->capacity * 2;
+        builder->stack = realloc(builder->stack, builder->capacity * sizeof(YacJSONValue *));
+        assert(builder->stack != NULL);
+    }
+    builder->stack[builder->depth++] = value;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_tree_builder_start_object(void *ctx) {
+    YacJSONTreeBuilder *builder = ctx;
+    YacJSONValue *value = yacjson_value_new(builder->allocator, YACJSON_OBJECT);
+    value->data.object = yacdoc_hashmap_new_with(builder->allocator);
+    return yacjson_tree_builder_push(builder, value);
+}
+
+static YacJSONSaxAction yacjson_tree_builder_start_array(void *ctx) {
+    YacJSONTreeBuilder *builder = ctx;
+    YacJSONValue *value = yacjson_value_new(builder->allocator, YACJSON_ARRAY);
+    value->data.array = yacdoc_arraylist_new_with(builder->allocator);
+    return yacjson_tree_builder_push(builder, value);
+}
+
+static YacJSONSaxAction yacjson_tree_builder_end(void *ctx) {
+    YacJSONTreeBuilder *builder = ctx;
+    builder->depth--;
+    return YACJSON_SAX_CONTINUE;
+}
+
+// A closed array gives back the slack of its last doubling
+static YacJSONSaxAction yacjson_tree_builder_end_array(void *ctx) {
+    YacJSONTreeBuilder *builder = ctx;
+    YacJSONArray *array = yacjson_value_to_array(builder->stack[--builder->depth]);
+    if (array->packed_kind == YACJSON_ARRAY_BOXED) yacdoc_arraylist_shrink_to_fit(array);
+    return YACJSON_SAX_CONTINUE;
+}
+
+// Objects of one parse share their keys through the builder's key table, so
+// an array of records stores and hashes each member name once. Keys are
+// unescaped before they are interned, so they are looked up by their text
+static YacJSONSaxAction yacjson_tree_builder_key(void *ctx, const char *key, size_t len) {
+    YacJSONTreeBuilder *builder = ctx;
+    if (builder->keys == NULL) builder->keys = yacdoc_key_table_new_with(builder->allocator);
+    char *unescaped = yacjson_key_unescape(key, &len);
+    builder->key = yacdoc_key_table_intern(builder->keys, unescaped != NULL ? unescaped : key, len);
+    free(unescaped);
+    return YACJSON_SAX_CONTINUE;
+}
+
+static void yacjson_tree_builder_release_keys(YacJSONTreeBuilder *builder) {
+    if (builder->keys != NULL) yacdoc_key_table_free(builder->keys);
+    builder->keys = NULL;
+    builder->key = NULL;
+}
+
+// Elements of an array go through the yacjson_array_add_ functions, which keep
+// arrays of only integers, only decimals or only booleans unboxed
+static YacJSONArray *yacjson_tree_builder_array(YacJSONTreeBuilder *builder) {
+    if (builder->depth == 0 || !yacjson_value_is_array(builder->stack[builder->depth - 1])) return NULL;
+    return yacjson_value_to_array(builder->stack[builder->depth - 1]);
+}
+
+static YacJSONSaxAction yacjson_tree_builder_boolean(void *ctx, bool boolean) {
+    YacJSONTreeBuilder *builder = ctx;
+    YacJSONArray *array = yacjson_tree_builder_array(builder);
+    if (array != NULL) {
+        yacjson_array_add_boolean(array, boolean);
+        return YACJSON_SAX_CONTINUE;
+    }
+    YacJSONValue *value = yacjson_value_new(builder->allocator, YACJSON_BOOLEAN);
+    value->data.boolean = boolean;
+    yacjson_tree_builder_attach(builder, value);
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_tree_builder_integer(void *ctx, long integer) {
+    YacJSONTreeBuilder *builder = ctx;
+    YacJSONArray *array = yacjson_tree_builder_array(builder);
+    if (array != NULL) {
+        yacjson_array_add_integer(array, integer);
+        return YACJSON_SAX_CONTINUE;
+    }
+    YacJSONValue *value = yacjson_value_new(builder->allocator, YACJSON_INTEGER);
+    value->data.integer = integer;
+    yacjson_tree_builder_attach(builder, value);
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_tree_builder_decimal(void *ctx, double decimal) {
+    YacJSONTreeBuilder *builder = ctx;
+    YacJSONArray *array = yacjson_tree_builder_array(builder);
+    if (array != NULL) {
+        yacjson_array_add_decimal(array, decimal);
+        return YACJSON_SAX_CONTINUE;
+    }
+    YacJSONValue *value = yacjson_value_new(builder->allocator, YACJSON_DECIMAL);
+    value->data.decimal = decimal;
+    yacjson_tree_builder_attach(builder, value);
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_tree_builder_string(void *ctx, const char *string, size_t len) {
+    YacJSONTreeBuilder *builder = ctx;
+    YacJSONValue *value;
+    if (builder->is_insitu) {
+        // The source outlives the tree and is writable, so the string is
+        // referenced where it is and unescaped there on first access
+        value = yacjson_value_new(builder->allocator, YACJSON_STRING);
+        value->data.string.ptr = (char *) string;
+        value->data.string.len = len;
+        value->data.string.is_raw = true;
+    } else {
+        value = yacjson_value_from_buffer(builder->allocator, string, len, true);
+    }
+    yacjson_tree_builder_attach(builder, value);
+    return YACJSON_SAX_CONTINUE;
+}
+
+// Trees have no null type and keep null as the string "null", copied since
+// there is no source text to point to in place
+static YacJSONSaxAction yacjson_tree_builder_null(void *ctx) {
+    YacJSONTreeBuilder *builder = ctx;
+    yacjson_tree_builder_attach(builder, yacjson_value_from_buffer(builder->allocator, "null", 4, false));
+    return YACJSON_SAX_CONTINUE;
+}
+
+static const YacJSONSaxHandler yacjson_tree_builder_handler = {
+    .start_object = yacjson_tree_builder_start_object,
+    .end_object = yacjson_tree_builder_end,
+    .start_array = yacjson_tree_builder_start_array,
+    .end_array = yacjson_tree_builder_end_array,
+    .key = yacjson_tree_builder_key,
+    .null = yacjson_tree_builder_null,
+    .boolean = yacjson_tree_builder_boolean,
+    .integer = yacjson_tree_builder_integer,
+    .decimal = yacjson_tree_builder_decimal,
+    .string = yacjson_tree_builder_string,
+};
+
+YacJSONTreeBuilder *yacjson_tree_builder_new() {
+    return yacjson_tree_builder_new_with(NULL);
+}
+
+YacJSONTreeBuilder *yacjson_tree_builder_new_with(const YacDocAllocator *allocator) {
+    YacJSONTreeBuilder *builder = malloc(sizeof(YacJSONTreeBuilder));
+    assert(builder != NULL);
+    memset(builder, 0, sizeof(YacJSONTreeBuilder));
+    builder->allocator = allocator;
+    return builder;
+}
+
+void yacjson_tree_builder_free(YacJSONTreeBuilder *builder) {
+    if (builder->root != NULL) yacjson_value_free_void(builder->root, builder->allocator);
+    free(builder->stack);
+    yacjson_tree_builder_release_keys(builder);
+    free(builder);
+}
+
+const YacJSONSaxHandler *yacjson_tree_builder_sax_handler() {
+    return &yacjson_tree_builder_handler;
+}
+
+// Values taken out share no keys with the ones built after them, so each can
+// be freed on its own thread
+YacJSONValue *yacjson_tree_builder_take(YacJSONTreeBuilder *builder) {
+    YacJSONValue *root = builder->root;
+    builder->root = NULL;
+    builder->depth = 0;
+    yacjson_tree_builder_release_keys(builder);
+    return root;
+}
+
+static YacJSONValue *yacjson_parse_buffer_in(const YacDocAllocator *allocator, bool is_insitu, const char *data, size_t len) {
+    YacJSONTreeBuilder builder = {allocator, is_insitu, NULL, NULL, 0, 0, NULL, NULL};
+    YacJSONSaxResult result = yacjson_sax_parse_buffer(data, len, &yacjson_tree_builder_handler, &builder);
+    free(builder.stack);
+    yacjson_tree_builder_release_keys(&builder);
+    if (result != YACJSON_SAX_DONE) {
+        if (builder.root != NULL) yacjson_value_free_void(builder.root, allocator);
+        return NULL;
+    }
+    return builder.root;
+}
+
+struct YacJSONParser {
+    YacJSONPushParser *push;
+    YacJSONTreeBuilder builder;
+};
+
+YacJSONParser *yacjson_parser_new() {
+    return yacjson_parser_new_with(NULL);
+}
+
+YacJSONParser *yacjson_parser_new_with(const YacDocAllocator *allocator) {
+    YacJSONParser *parser = malloc(sizeof(YacJSONParser));
+    assert(parser != NULL);
+    memset(&parser->builder, 0, sizeof(YacJSONTreeBuilder));
+    parser->builder.allocator = allocator;
+    parser->push = yacjson_push_parser_new(&yacjson_tree_builder_handler, &parser->builder);
+    return parser;
+}
+
+bool yacjson_parser_feed(YacJSONParser *parser, const char *data, size_t len) {
+    return yacjson_push_parser_feed(parser->push, data, len);
+}
+
+YacJSONValue *yacjson_parser_finish(YacJSONParser *parser) {
+    YacJSONValue *root = parser->builder.root;
+    if (yacjson_push_parser_finish(parser->push) != YACJSON_SAX_DONE) {
+        if (root != NULL) yacjson_value_free_void(root, parser->builder.allocator);
+        root = NULL;
+    }
+    yacjson_push_parser_free(parser->push);
+    free(parser->builder.stack);
+    yacjson_tree_builder_release_keys(&parser->builder);
+    free(parser);
+    return root;
+}
+
+static char *yacjson_read_file(const char *filepath, size_t *len) {
+    FILE *file = fopen(filepath, "rb");
+    assert(file != NULL);
+    size_t capacity = 1 << 16, read;
+    char *data = malloc(capacity);
+    assert(data != NULL);
+    *len = 0;
+    while ((read = fread(data + *len, 1, capacity - *len, file)) > 0) {
+        *len += read;
+        if (*len == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+            assert(data != NULL);
         }
-        if (!is_quoted && is_key_added) {
-            switch (ch) {
-                case ' ':
-                case '\n':
-                case '\t':
-                    continue;
-                case '{':
-                    yacjson_object_add(object, key, yacjson_parse_object_from_file(file));
-                    pos = 0;
-                    is_value_added = true;
-                    continue;
-                case '[':
-                    yacjson_object_add(object, key, yacjson_parse_array_from_file(file));
-                    pos = 0;
-                    is_value_added = true;
-                    continue;
-                case ',':
-                    if (!is_value_added) {
-                        buffer[pos] = '\0';
-                        yacjson_object_add(object, key, yacjson_parse_primitive_from_string(buffer));
-                    }
-                    pos = 0;
-                    is_key_added = false;
-                    is_value_added = false;
-                    continue;
-                case '}':
-                    if (!is_value_added) {
-                        buffer[pos] = '\0';
-                        yacjson_object_add(object, key, yacjson_parse_primitive_from_string(buffer));
-                    }
-                    return yacjson_value_from_object(object);
-            }
+    }
+    fclose(file);
+    return data;
+}
+
+YacJSONValue *yacjson_parse_buffer(const char *data, size_t len) {
+    return yacjson_parse_buffer_in(NULL, false, data, len);
+}
+
+YacJSONValue *yacjson_parse_buffer_with(const char *data, size_t len, const YacDocAllocator *allocator) {
+    return yacjson_parse_buffer_in(allocator, false, data, len);
+}
+
+YacJSONValue *yacjson_parse_mmap(const char *filepath) {
+    YacDocMappedFile file;
+    yacdoc_mapped_file_open(&file, filepath);
+    YacJSONValue *value = yacjson_parse_buffer(file.data, file.len);
+    yacdoc_mapped_file_close(&file);
+    return value;
+}
+
+YacJSONValue *yacjson_parse(const char *filepath) {
+    return yacjson_parse_with(filepath, NULL);
+}
+
+YacJSONValue *yacjson_parse_with(const char *filepath, const YacDocAllocator *allocator) {
+    size_t len;
+    char *data = yacjson_read_file(filepath, &len);
+    YacJSONValue *value = yacjson_parse_buffer_in(allocator, false, data, len);
+    free(data);
+    return value;
+}
+
+static YacJSONDocument *yacjson_document_new(YacDocMappedFile *file, char *source, char *data, size_t len) {
+    YacJSONDocument *doc = malloc(sizeof(YacJSONDocument));
+    assert(doc != NULL);
+    doc->arena = yacdoc_arena_new();
+    doc->file.data = NULL;
+    doc->file.len = 0;
+    if (file != NULL) doc->file = *file;
+    doc->source = source;
+    doc->root = yacjson_parse_buffer_in(yacdoc_arena_allocator(doc->arena), true, data, len);
+    if (doc->root == NULL) {
+        yacjson_document_free(doc);
+        return NULL;
+    }
+    return doc;
+}
+
+YacJSONDocument *yacjson_document_parse_buffer(const char *data, size_t len) {
+    // One copy of the whole input replaces a copy per string
+    char *source = malloc(len > 0 ? len : 1);
+    assert(source != NULL);
+    memcpy(source, data, len);
+    return yacjson_document_new(NULL, source, source, len);
+}
+
+YacJSONDocument *yacjson_document_parse_insitu(char *data, size_t len) {
+    return yacjson_document_new(NULL, NULL, data, len);
+}
+
+YacJSONDocument *yacjson_document_parse_mmap(const char *filepath) {
+    YacDocMappedFile file;
+    yacdoc_mapped_file_open_writable(&file, filepath);
+    return yacjson_document_new(&file, NULL, file.data, file.len);
+}
+
+YacJSONDocument *yacjson_document_parse(const char *filepath) {
+    size_t len;
+    char *data = yacjson_read_file(filepath, &len);
+    return yacjson_document_new(NULL, data, data, len);
+}
+
+void yacjson_document_free(YacJSONDocument *doc) {
+    yacdoc_arena_free(doc->arena);
+    yacdoc_mapped_file_close(&doc->file);
+    free(doc->source);
+    free(doc);
+}
+
+YacJSONValue *yacjson_document_root(YacJSONDocument *doc) {
+    return doc->root;
+}
+
+YacJSONObject *yacjson_document_object_new(YacJSONDocument *doc) {
+    return yacdoc_hashmap_new_with(yacdoc_arena_allocator(doc->arena));
+}
+
+YacJSONArray *yacjson_document_array_new(YacJSONDocument *doc) {
+    return yacdoc_arraylist_new_with(yacdoc_arena_allocator(doc->arena));
+}
+
+// Output goes through one buffer: grown as needed when serializing to memory,
+// flushed whenever full when serializing to a file descriptor. Pretty output
+// gets its line breaks from a precomputed newline-plus-indent string. cache is
+// set only by yacjson_serialize_cache_update
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+    int fd;
+    bool is_failed;
+    bool is_pretty;
+    size_t indent_width;
+    char indent[1 + YACJSON_WRITER_MAX_INDENT];
+    YacJSONSerializeCache *cache;
+} YacJSONWriter;
+
+static void yacjson_writer_init(YacJSONWriter *writer, int fd, const YacJSONSerializeOptions *options) {
+    writer->capacity = fd < 0 ? YACJSON_WRITER_INITIAL_CAPACITY : YACJSON_WRITER_FD_CAPACITY;
+    writer->data = malloc(writer->capacity);
+    assert(writer->data != NULL);
+    writer->len = 0;
+    writer->fd = fd;
+    writer->is_failed = false;
+    writer->is_pretty = options != NULL && options->mode == YACJSON_SERIALIZE_PRETTY;
+    writer->indent_width = writer->is_pretty ? (size_t) options->indent_width : 0;
+    writer->indent[0] = '\n';
+    memset(writer->indent + 1, writer->is_pretty ? options->indent_char : ' ', YACJSON_WRITER_MAX_INDENT);
+    writer->cache = NULL;
+}
+
+static void yacjson_writer_output(YacJSONWriter *writer, const char *data, size_t len) {
+    while (len > 0 && !writer->is_failed) {
+        ssize_t written = write(writer->fd, data, len);
+        if (written < 0) {
+            if (errno != EINTR) writer->is_failed = true;
+            continue;
         }
-        buffer[pos++] = (char) ch;
+        data += written;
+        len -= written;
     }
-    return NULL;
 }
 
-static YacJSONValue *yacjson_parse_array_from_file(FILE *file) {
-    YacJSONArray *array = yacjson_array_new();
-    int ch, pos = 0;
-    static char buffer[YACJSON_MAX_BUFFER_LEN];
-    bool is_quoted = false;
-    bool is_value_added = false;
-    while ((ch = fgetc(file)) != EOF) {
-        if (ch == '"') {
-            is_quoted = !is_quoted || buffer[pos - 1] == '\\';
+static void yacjson_writer_flush(YacJSONWriter *writer) {
+    if (writer->fd < 0) return;
+    yacjson_writer_output(writer, writer->data, writer->len);
+    writer->len = 0;
+}
+
+// Returns room for len more bytes at the end of the buffer
+static char *yacjson_writer_reserve(YacJSONWriter *writer, size_t len) {
+    if (writer->capacity - writer->len < len) {
+        yacjson_writer_flush(writer);
+        if (writer->capacity - writer->len < len) {
+            while (writer->capacity - writer->len < len) writer->capacity *= 2;
+            writer->data = realloc(writer->data, writer->capacity);
+            assert(writer->data != NULL);
         }
-        if (!is_quoted) {
-            switch (ch) {
-                case ' ':
-                case '\n':
-                case '\t':
-                    continue;
-                case '{':
-                    yacjson_array_add(array, yacjson_parse_object_from_file(file));
-                    pos = 0;
-                    is_value_added = true;
-                    continue;
-                case '[':
-                    yacjson_array_add(array, yacjson_parse_array_from_file(file));
-                    pos = 0;
-                    is_value_added = true;
-                    continue;
-                case ',':
-                    if (!is_value_added) {
-                        buffer[pos] = '\0';
-                        yacjson_array_add(array, yacjson_parse_primitive_from_string(buffer));
-                    }
-                    pos = 0;
-                    is_value_added = false;
-                    continue;
-                case ']':
-                    if (!is_value_added) {
-                        buffer[pos] = '\0';
-                        yacjson_array_add(array, yacjson_parse_primitive_from_string(buffer));
-                    }
-                    return yacjson_value_from_array(array);
-            }
+    }
+    return writer->data + writer->len;
+}
+
+static void yacjson_writer_write(YacJSONWriter *writer, const char *data, size_t len) {
+    if (writer->capacity - writer->len < len && writer->fd >= 0) {
+        // Too big to be worth copying: goes out directly
+        yacjson_writer_flush(writer);
+        if (len >= writer->capacity) {
+            yacjson_writer_output(writer, data, len);
+            return;
         }
-        buffer[pos++] = (char) ch;
     }
-    return NULL;
+    memcpy(yacjson_writer_reserve(writer, len), data, len);
+    writer->len += len;
 }
 
-YacJSONValue *yacjson_parse(const char *filepath) {
-    FILE *file = fopen(filepath, "r");
-    assert(file != NULL);
-    int ch;
-    while ((ch = fgetc(file)) != EOF) {
-        switch (ch) {
-            case '{':
-                return yacjson_parse_object_from_file(file);
-            case '[':
-                return yacjson_parse_array_from_file(file);
+static void yacjson_writer_put(YacJSONWriter *writer, char c) {
+    if (writer->len == writer->capacity) yacjson_writer_reserve(writer, 1);
+    writer->data[writer->len++] = c;
+}
+
+static void yacjson_writer_newline(YacJSONWriter *writer, int depth) {
+    if (!writer->is_pretty) return;
+    size_t len = depth * writer->indent_width;
+    size_t chunk = len < YACJSON_WRITER_MAX_INDENT ? len : YACJSON_WRITER_MAX_INDENT;
+    yacjson_writer_write(writer, writer->indent, 1 + chunk);
+    for (len -= chunk; len > 0; len -= chunk) {
+        chunk = len < YACJSON_WRITER_MAX_INDENT ? len : YACJSON_WRITER_MAX_INDENT;
+        yacjson_writer_write(writer, writer->indent + 1, chunk);
+    }
+}
+
+// Writes the escape sequence for a character that cannot appear as is in a
+// string, at most 6 bytes
+static size_t yacjson_string_escape_char(unsigned char c, char *out) {
+    out[0] = '\\';
+    switch (c) {
+        case '"':
+            out[1] = '"';
+            return 2;
+        case '\\':
+            out[1] = '\\';
+            return 2;
+        case '\b':
+            out[1] = 'b';
+            return 2;
+        case '\f':
+            out[1] = 'f';
+            return 2;
+        case '\n':
+            out[1] = 'n';
+            return 2;
+        case '\r':
+            out[1] = 'r';
+            return 2;
+        case '\t':
+            out[1] = 't';
+            return 2;
+        default:
+            memcpy(out + 1, "u00", 3);
+            out[4] = "0123456789abcdef"[c >> 4];
+            out[5] = "0123456789abcdef"[c & 0xF];
+            return 6;
+    }
+}
+
+// out needs room for 6 * len bytes; no quotes are added
+size_t yacjson_string_escape(char *out, const char *data, size_t len) {
+    char *start = out;
+    const char *run = data, *end = data + len;
+    for (const char *ptr = run; ptr < end; ptr++) {
+        unsigned char c = *ptr;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        memcpy(out, run, ptr - run);
+        out += ptr - run;
+        out += yacjson_string_escape_char(c, out);
+        run = ptr + 1;
+    }
+    memcpy(out, run, end - run);
+    return out + (end - run) - start;
+}
+
+// Strings nobody has read are still in their input form and are written back
+// untouched; unescaped ones are escaped again, copying the runs in between
+// escapes in one go
+static void yacjson_serialize_string(YacJSONWriter *writer, YacJSONString *string) {
+    yacjson_writer_put(writer, '"');
+    if (string->is_raw) {
+        yacjson_writer_write(writer, string->ptr, string->len);
+        yacjson_writer_put(writer, '"');
+        return;
+    }
+    const char *run = string->ptr, *end = string->ptr + string->len;
+    for (const char *ptr = run; ptr < end; ptr++) {
+        unsigned char c = *ptr;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        yacjson_writer_write(writer, run, ptr - run);
+        run = ptr + 1;
+        writer->len += yacjson_string_escape_char(c, yacjson_writer_reserve(writer, 6));
+    }
+    yacjson_writer_write(writer, run, end - run);
+    yacjson_writer_put(writer, '"');
+}
+
+static void yacjson_serialize_value(YacJSONWriter *writer, YacJSONValue *value, int depth);
+
+// One line of a container: key is NULL for array elements. Keys are stored
+// unescaped, so they are escaped again like strings
+static void yacjson_serialize_member(YacJSONWriter *writer, const char *key, YacJSONValue *value, int depth, bool is_last) {
+    yacjson_writer_newline(writer, depth);
+    if (key != NULL) {
+        size_t len = strlen(key);
+        yacjson_writer_put(writer, '"');
+        writer->len += yacjson_string_escape(yacjson_writer_reserve(writer, 6 * len), key, len);
+        if (writer->is_pretty) {
+            yacjson_writer_write(writer, "\": ", 3);
+        } else {
+            yacjson_writer_write(writer, "\":", 2);
+        }
+    }
+    yacjson_serialize_value(writer, value, depth);
+    if (!is_last) yacjson_writer_put(writer, ',');
+}
+
+// Writes a packed array's elements straight from its buffer, without boxing
+// them, so that serializing does not modify the tree
+static void yacjson_serialize_packed(YacJSONWriter *writer, YacJSONArray *array, int depth) {
+    for (int i = 0; i < array->size; i++) {
+        yacjson_writer_newline(writer, depth);
+        char *number = yacjson_writer_reserve(writer, YACJSON_NUMBER_MAX_FORMAT_LEN);
+        switch (yacjson_array_packing(array)) {
+            case YACJSON_ARRAY_INTEGERS:
+                writer->len += yacjson_number_format_integer(yacjson_array_as_longs(array)[i], number);
+                break;
+            case YACJSON_ARRAY_DECIMALS:
+                writer->len += yacjson_number_format_decimal(yacjson_array_as_doubles(array)[i], number);
+                break;
+            default:
+                if (yacjson_array_bit(array->packed, i)) {
+                    yacjson_writer_write(writer, "true", 4);
+                } else {
+                    yacjson_writer_write(writer, "false", 5);
+                }
+                break;
         }
+        if (i < array->size - 1) yacjson_writer_put(writer, ',');
     }
-    return NULL;
 }
 
-static void yacjson_serialize_to_file(YacJSONValue *value, FILE *file, int depth) {
+static void yacjson_serialize_container(YacJSONWriter *writer, YacJSONValue *value, int depth);
+static void yacjson_serialize_cached(YacJSONWriter *writer, YacJSONValue *value, int depth);
+
+static void yacjson_serialize_value(YacJSONWriter *writer, YacJSONValue *value, int depth) {
     switch (value->type) {
         case YACJSON_BOOLEAN:
-            fprintf(file, "%s", yacjson_value_to_boolean(value) ? "true" : "false");
+            if (yacjson_value_to_boolean(value)) {
+                yacjson_writer_write(writer, "true", 4);
+            } else {
+                yacjson_writer_write(writer, "false", 5);
+            }
             break;
-        case YACJSON_INTEGER:
-            fprintf(file, "%ld", yacjson_value_to_integer(value));
+        case YACJSON_INTEGER: {
+            char *number = yacjson_writer_reserve(writer, YACJSON_NUMBER_MAX_FORMAT_LEN);
+            writer->len += yacjson_number_format_integer(yacjson_value_to_integer(value), number);
             break;
-        case YACJSON_DECIMAL:
-            fprintf(file, "%lf", yacjson_value_to_decimal(value));
+        }
+        case YACJSON_DECIMAL: {
+            // Shortest text that reads back as the same double
+            char *number = yacjson_writer_reserve(writer, YACJSON_NUMBER_MAX_FORMAT_LEN);
+            writer->len += yacjson_number_format_decimal(yacjson_value_to_decimal(value), number);
             break;
+        }
         case YACJSON_STRING:
-            fputc('"', file);
-            fputs(yacjson_value_to_string(value), file);
-            fputc('"', file);
+            yacjson_serialize_string(writer, &value->data.string);
             break;
+        case YACJSON_OBJECT:
+        case YACJSON_ARRAY:
+            if (writer->cache != NULL) {
+                yacjson_serialize_cached(writer, value, depth);
+            } else {
+                yacjson_serialize_container(writer, value, depth);
+            }
+            break;
+    }
+}
+
+static void yacjson_serialize_container(YacJSONWriter *writer, YacJSONValue *value, int depth) {
+    switch (value->type) {
         case YACJSON_OBJECT: {
-            fputs("{\n", file);
-            YacJSONObjectItem *item;
             YacJSONObject *object = yacjson_value_to_object(value);
-            YacJSONObjectIterator *it = yacjson_object_iterator_new(object);
-            while ((item = yacjson_object_iterator_next(it)) != NULL) {
-                for (int i = 0; i < depth; i++) fputc('\t', file);
-                fputc('"', file);
-                fputs(yacjson_object_item_key(item), file);
-                fputs("\": ", file);
-                yacjson_serialize_to_file(yacjson_object_item_value(item), file, depth + 1);
-                if (yacjson_object_iterator_count(it) < yacjson_object_size(object)) fputc(',', file);
-                fputc('\n', file);
+            yacjson_writer_put(writer, '{');
+            if (yacjson_object_size(object) == 0) {
+                yacjson_writer_put(writer, '}');
+                break;
             }
-            yacjson_object_iterator_free(it);
-            for (int i = 0; i < depth - 1; i++) fputc('\t', file);
-            fputc('}', file);
+            YacJSONObjectItem *item;
+            YacJSONObjectIterator it;
+            yacjson_object_iterator_init(&it, object);
+            while ((item = yacjson_object_iterator_next(&it)) != NULL) {
+                bool is_last = yacjson_object_iterator_count(&it) == yacjson_object_size(object);
+                yacjson_serialize_member(writer, yacjson_object_item_key(item), yacjson_object_item_value(item), depth + 1, is_last);
+            }
+            yacjson_writer_newline(writer, depth);
+            yacjson_writer_put(writer, '}');
             break;
         }
         case YACJSON_ARRAY: {
-            fputs("[\n", file);
-            YacJSONArrayItem *item;
             YacJSONArray *array = yacjson_value_to_array(value);
-            YacJSONArrayIterator *it = yacjson_array_iterator_new(array);
-            while ((item = yacjson_array_iterator_next(it)) != NULL) {
-                for (int i = 0; i < depth; i++) fputc('\t', file);
-                yacjson_serialize_to_file(yacjson_array_item_value(item), file, depth + 1);
-                if (yacjson_array_iterator_count(it) < yacjson_array_size(array)) fputc(',', file);
-                fputc('\n', file);
+            yacjson_writer_put(writer, '[');
+            if (yacjson_array_size(array) == 0) {
+                yacjson_writer_put(writer, ']');
+                break;
+            }
+            if (yacjson_array_packing(array) != YACJSON_ARRAY_BOXED) {
+                yacjson_serialize_packed(writer, array, depth + 1);
+                yacjson_writer_newline(writer, depth);
+                yacjson_writer_put(writer, ']');
+                break;
             }
-            yacjson_array_iterator_free(it);
-            for (int i = 0; i < depth - 1; i++) fputc('\t', file);
-            fputc(']', file);
+            YacJSONArrayItem *item;
+            YacJSONArrayIterator it;
+            yacjson_array_iterator_init(&it, array);
+            while ((item = yacjson_array_iterator_next(&it)) != NULL) {
+                bool is_last = yacjson_array_iterator_count(&it) == yacjson_array_size(array);
+                yacjson_serialize_member(writer, NULL, yacjson_array_item_value(item), depth + 1, is_last);
+            }
+            yacjson_writer_newline(writer, depth);
+            yacjson_writer_put(writer, ']');
+            break;
+        }
+        default:
             break;
+    }
+}
+
+struct YacJSONSerializeCache {
+    YacJSONValue *root;
+    YacJSONSerializeOptions options;
+    bool has_options;
+    char *data;
+    size_t len;
+    // Container being formatted and where its text starts in the last output
+    // (SIZE_MAX if it was not in it) and in the new one
+    YacJSONCacheRecord *current;
+    size_t old_start;
+    size_t new_start;
+};
+
+static YacJSONCacheRecord **yacjson_value_cache_record(YacJSONValue *value) {
+    if (yacjson_value_is_object(value)) return (YacJSONCacheRecord **) &yacjson_value_to_object(value)->cache;
+    return (YacJSONCacheRecord **) &yacjson_value_to_array(value)->cache;
+}
+
+// Copies the text of a clean container from the last output, or formats a
+// dirty or new one, whose own children may again be copied
+static void yacjson_serialize_cached(YacJSONWriter *writer, YacJSONValue *value, int depth) {
+    YacJSONSerializeCache *cache = writer->cache;
+    YacJSONCacheRecord **slot = yacjson_value_cache_record(value);
+    YacJSONCacheRecord *record = *slot;
+    size_t start = writer->len;
+    if (record != NULL && !record->is_dirty && cache->old_start != SIZE_MAX) {
+        yacjson_writer_write(writer, cache->data + cache->old_start + record->offset, record->len);
+        record->offset = start - cache->new_start;
+        return;
+    }
+    size_t old_start = SIZE_MAX;
+    if (record == NULL) {
+        record = malloc(sizeof(YacJSONCacheRecord));
+        assert(record != NULL);
+        *slot = record;
+    } else if (cache->old_start != SIZE_MAX) {
+        old_start = cache->old_start + record->offset;
+    }
+    record->parent = cache->current;
+    record->offset = start - cache->new_start;
+    YacJSONCacheRecord *parent = cache->current;
+    size_t parent_old_start = cache->old_start;
+    size_t parent_new_start = cache->new_start;
+    cache->current = record;
+    cache->old_start = old_start;
+    cache->new_start = start;
+    yacjson_serialize_container(writer, value, depth);
+    cache->current = parent;
+    cache->old_start = parent_old_start;
+    cache->new_start = parent_new_start;
+    record->len = writer->len - start;
+    record->is_dirty = false;
+}
+
+typedef struct {
+    const YacJSONSerializeOptions *options;
+    char **keys;
+    YacJSONValue **values;
+    int count;
+    int chunk_count;
+    YacJSONWriter *writers;
+} YacJSONSerializeJob;
+
+static void yacjson_serialize_chunk(void *ctx, int index) {
+    YacJSONSerializeJob *job = ctx;
+    int start = (int) ((long) job->count * index / job->chunk_count);
+    int end = (int) ((long) job->count * (index + 1) / job->chunk_count);
+    YacJSONWriter *writer = &job->writers[index];
+    yacjson_writer_init(writer, -1, job->options);
+    for (int i = start; i < end; i++) {
+        yacjson_serialize_member(writer, job->keys != NULL ? job->keys[i] : NULL, job->values[i], 1, i == job->count - 1);
+    }
+}
+
+// Splits the members of a large root container into chunks that workers
+// format into buffers of their own, then appends the buffers in order. Every
+// member is written exactly as the sequential serializer would write it, so
+// the output is the same byte for byte
+static void yacjson_serialize_root(YacJSONWriter *writer, YacJSONValue *value, const YacJSONSerializeOptions *options, int threads) {
+    YacJSONSerializeJob job;
+    bool is_object = value->type == YACJSON_OBJECT;
+    if (value->type == YACJSON_ARRAY && yacjson_array_packing(yacjson_value_to_array(value)) == YACJSON_ARRAY_BOXED) {
+        job.count = yacjson_array_size(yacjson_value_to_array(value));
+    } else if (is_object) {
+        job.count = yacjson_object_size(yacjson_value_to_object(value));
+    } else {
+        job.count = 0;
+    }
+    if (threads == 1 || job.count < YACJSON_SERIALIZE_MIN_PARALLEL_COUNT) {
+        yacjson_serialize_value(writer, value, 0);
+        return;
+    }
+    YacDocThreadPool *pool = yacdoc_threadpool_new(threads);
+    job.options = options;
+    job.chunk_count = yacdoc_threadpool_size(pool) * YACJSON_SERIALIZE_CHUNKS_PER_THREAD;
+    job.keys = is_object ? malloc(job.count * sizeof(char *)) : NULL;
+    job.values = malloc(job.count * sizeof(YacJSONValue *));
+    job.writers = malloc(job.chunk_count * sizeof(YacJSONWriter));
+    assert(job.values != NULL && job.writers != NULL && (!is_object || job.keys != NULL));
+    if (is_object) {
+        YacJSONObjectItem *item;
+        YacJSONObjectIterator it;
+        yacjson_object_iterator_init(&it, yacjson_value_to_object(value));
+        for (int i = 0; (item = yacjson_object_iterator_next(&it)) != NULL; i++) {
+            job.keys[i] = yacjson_object_item_key(item);
+            job.values[i] = yacjson_object_item_value(item);
         }
+    } else {
+        for (int i = 0; i < job.count; i++) job.values[i] = yacjson_array_get(yacjson_value_to_array(value), i);
     }
+    yacdoc_threadpool_run(pool, yacjson_serialize_chunk, &job, job.chunk_count);
+    yacdoc_threadpool_free(pool);
+    if (writer->fd < 0) {
+        size_t len = 0;
+        for (int i = 0; i < job.chunk_count; i++) len += job.writers[i].len;
+        yacjson_writer_reserve(writer, len + 2);
+    }
+    yacjson_writer_put(writer, is_object ? '{' : '[');
+    for (int i = 0; i < job.chunk_count; i++) {
+        yacjson_writer_write(writer, job.writers[i].data, job.writers[i].len);
+        free(job.writers[i].data);
+    }
+    yacjson_writer_newline(writer, 0);
+    yacjson_writer_put(writer, is_object ? '}' : ']');
+    free(job.keys);
+    free(job.values);
+    free(job.writers);
+}
+
+char *yacjson_serialize_to_buffer(YacJSONValue *value, const YacJSONSerializeOptions *options, size_t *len) {
+    return yacjson_serialize_to_buffer_parallel(value, options, 1, len);
+}
+
+bool yacjson_serialize_to_fd(YacJSONValue *value, int fd, const YacJSONSerializeOptions *options) {
+    return yacjson_serialize_to_fd_parallel(value, fd, options, 1);
 }
 
 void yacjson_serialize(YacJSONValue *value, const char *filepath) {
-    FILE *file = fopen(filepath, "w");
-    yacjson_serialize_to_file(value, file, 1);
+    yacjson_serialize_parallel(value, filepath, 1);
+}
+
+char *yacjson_serialize_to_buffer_parallel(YacJSONValue *value, const YacJSONSerializeOptions *options, int threads, size_t *len) {
+    YacJSONWriter writer;
+    yacjson_writer_init(&writer, -1, options);
+    yacjson_serialize_root(&writer, value, options, threads);
+    yacjson_writer_put(&writer, '\0');
+    if (len != NULL) *len = writer.len - 1;
+    return writer.data;
+}
+
+bool yacjson_serialize_to_fd_parallel(YacJSONValue *value, int fd, const YacJSONSerializeOptions *options, int threads) {
+    YacJSONWriter writer;
+    yacjson_writer_init(&writer, fd, options);
+    yacjson_serialize_root(&writer, value, options, threads);
+    yacjson_writer_flush(&writer);
+    free(writer.data);
+    return !writer.is_failed;
+}
+
+void yacjson_serialize_parallel(YacJSONValue *value, const char *filepath, int threads) {
+    YacJSONSerializeOptions options = {YACJSON_SERIALIZE_PRETTY, '\t', 1};
+    YacJSONWriter writer;
+    int fd = open(filepath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    assert(fd != -1);
+    yacjson_writer_init(&writer, fd, &options);
+    yacjson_serialize_root(&writer, value, &options, threads);
     // End file with a new line char
-    fputc('\n', file);
-    fclose(file);
+    yacjson_writer_put(&writer, '\n');
+    yacjson_writer_flush(&writer);
+    free(writer.data);
+    close(fd);
+}
+
+YacJSONSerializeCache *yacjson_serialize_cache_new(YacJSONValue *root, const YacJSONSerializeOptions *options) {
+    YacJSONSerializeCache *cache = malloc(sizeof(YacJSONSerializeCache));
+    assert(cache != NULL);
+    cache->root = root;
+    cache->has_options = options != NULL;
+    if (options != NULL) cache->options = *options;
+    cache->data = NULL;
+    cache->len = 0;
+    return cache;
+}
+
+static void yacjson_serialize_cache_release(YacJSONValue *value) {
+    if (!yacjson_value_is_object(value) && !yacjson_value_is_array(value)) return;
+    YacJSONCacheRecord **slot = yacjson_value_cache_record(value);
+    // Only containers that were written have records, and so do all their
+    // ancestors; packed arrays hold no containers
+    if (*slot == NULL) return;
+    free(*slot);
+    *slot = NULL;
+    if (yacjson_value_is_object(value)) {
+        YacDocHashMapItem *item;
+        YacDocHashMapIterator it;
+        yacdoc_hashmap_iterator_init(&it, yacjson_value_to_object(value));
+        while ((item = yacdoc_hashmap_iterator_next(&it)) != NULL) yacjson_serialize_cache_release(item->value);
+    } else if (yacjson_array_packing(yacjson_value_to_array(value)) == YACJSON_ARRAY_BOXED) {
+        YacDocArrayListItem *item;
+        YacDocArrayListIterator it;
+        yacdoc_arraylist_iterator_init(&it, yacjson_value_to_array(value));
+        while ((item = yacdoc_arraylist_iterator_next(&it)) != NULL) yacjson_serialize_cache_release(item->value);
+    }
+}
+
+void yacjson_serialize_cache_free(YacJSONSerializeCache *cache) {
+    yacjson_serialize_cache_release(cache->root);
+    free(cache->data);
+    free(cache);
+}
+
+// The new output is built next to the last one, whose clean parts it copies,
+// then replaces it
+const char *yacjson_serialize_cache_update(YacJSONSerializeCache *cache, size_t *len) {
+    YacJSONWriter writer;
+    yacjson_writer_init(&writer, -1, cache->has_options ? &cache->options : NULL);
+    if (cache->len > 0) yacjson_writer_reserve(&writer, cache->len + 1);
+    writer.cache = cache;
+    cache->current = NULL;
+    cache->old_start = cache->data != NULL ? 0 : SIZE_MAX;
+    cache->new_start = 0;
+    yacjson_serialize_value(&writer, cache->root, 0);
+    yacjson_writer_put(&writer, '\0');
+    free(cache->data);
+    cache->data = writer.data;
+    cache->len = writer.len - 1;
+    if (len != NULL) *len = cache->len;
+    return cache->data;
 }
@@ -2,9 +2,15 @@
 #define YACJSON_CORE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+#include "allocator.h"
+#include "arena.h"
 #include "arraylist.h"
 #include "hashmap.h"
+#include "mapfile.h"
+#include "yacjson-sax.h"
 
 typedef YacDocHashMap YacJSONObject;
 typedef YacDocArrayList YacJSONArray;
@@ -23,6 +29,24 @@ typedef enum {
     YACJSON_STRING,
 } YacJSONValueType;
 
+// String bytes stay exactly as they appeared in the input, escape sequences
+// included, until the first yacjson_value_to_string, which unescapes them in
+// place and NUL-terminates them. Strings of a document point straight into the
+// document's source instead of being copied.
+//
+// Since reading a string may write to it, and so may reading a packed array
+// through element values or iterators (see YacJSONArrayPacking), a tree is
+// not safe to read from several threads at once as parsed. Calling
+// yacjson_value_resolve_strings on the root first does all the string writes
+// up front; after it, threads may share the tree as long as they read packed
+// arrays only with the typed yacjson_array_get_ functions or the
+// yacjson_array_as_ buffers, and nothing modifies it
+typedef struct {
+    char *ptr;
+    size_t len;
+    bool is_raw;
+} YacJSONString;
+
 typedef struct {
     YacJSONValueType type;
     union {
@@ -31,18 +55,96 @@ typedef struct {
         bool boolean;
         long integer;
         double decimal;
-        char *string;
+        YacJSONString string;
     } data;
 } YacJSONValue;
 
+// Owns every node, key and string parsed into it; released in one call by
+// yacjson_document_free, so its values must not be passed to yacjson_value_free.
+// The source text is kept alive as the backing store of its strings: mapped
+// copy-on-write, read into memory, copied once, or, for
+// yacjson_document_parse_insitu, borrowed from a caller buffer that must
+// outlive the document and is written to as strings are read
+typedef struct {
+    YacDocArena *arena;
+    YacJSONValue *root;
+    YacDocMappedFile file;
+    char *source;
+} YacJSONDocument;
+
+// How an array holds its elements. Arrays made only of integers, only of
+// decimals or only of booleans, whether parsed or built with the
+// yacjson_array_add_ functions, are kept unboxed in one buffer of longs,
+// doubles or bits (bit i of word i / 64) instead of one value per element.
+// yacjson_array_as_longs, _as_doubles and _as_bits return that buffer, to be
+// read and written in place for yacjson_array_size elements, or NULL when the
+// array is not packed that way; empty arrays never are. The typed
+// yacjson_array_get_ functions read it directly, but element values, iterators
+// and adding a value of another type box the whole array first, after which
+// the buffer is gone
+typedef enum {
+    YACJSON_ARRAY_BOXED,
+    YACJSON_ARRAY_INTEGERS,
+    YACJSON_ARRAY_DECIMALS,
+    YACJSON_ARRAY_BOOLEANS,
+} YacJSONArrayPacking;
+
+typedef enum {
+    YACJSON_SERIALIZE_COMPACT,
+    YACJSON_SERIALIZE_PRETTY,
+} YacJSONSerializeMode;
+
+// Compact output has no whitespace at all; pretty output puts every member on
+// its own line, indented by indent_width indent_chars per level. A NULL options
+// pointer means compact. The _parallel variants split a root container of many
+// members across threads workers, one per CPU when threads is 0 or less, and
+// write exactly the same bytes as their sequential counterparts
+typedef struct {
+    YacJSONSerializeMode mode;
+    char indent_char;
+    int indent_width;
+} YacJSONSerializeOptions;
+
+// Keeps the last output of a tree and where each object and array is in it,
+// so that yacjson_serialize_cache_update formats again only the containers
+// changed since and copies the text of all the others. The yacjson_object_add
+// and yacjson_array_add functions mark the containers they change;
+// yacjson_object_mark_dirty and yacjson_array_mark_dirty must be called after
+// changing a value in place, including through yacjson_array_as_longs and the
+// like. A tree can be followed by one cache at a time, which must be freed
+// before the tree. The returned buffer belongs to the cache and is valid until
+// the next update
+typedef struct YacJSONSerializeCache YacJSONSerializeCache;
+
+// Push parser that builds a tree from chunks passed to yacjson_parser_feed;
+// yacjson_parser_finish returns the root, or NULL if the input was incomplete
+// or malformed, and releases the parser
+typedef struct YacJSONParser YacJSONParser;
+
+// Builds heap trees out of SAX events, for layers that only turn parts of a
+// stream into values; yacjson_tree_builder_take hands over the value built so
+// far and leaves the builder ready for the next one
+typedef struct YacJSONTreeBuilder YacJSONTreeBuilder;
+
+// The _with functions take every node, key and string from allocator, which
+// must outlive what they build. The containers made there put the values
+// that their yacjson_object_add_ and yacjson_array_add_ functions create in
+// the same allocator, and a value passed to yacjson_object_add or
+// yacjson_array_add must come from the allocator of its container.
+// yacjson_value_free finds the allocator of a tree through its root object or
+// array; yacjson_value_free_with is for the other values a tree builder
+// made with an allocator can hand out
 YacJSONObject *yacjson_object_new();
 YacJSONArray *yacjson_array_new();
+YacJSONObject *yacjson_object_new_with(const YacDocAllocator *allocator);
+YacJSONArray *yacjson_array_new_with(const YacDocAllocator *allocator);
 void yacjson_value_free(YacJSONValue *value);
+void yacjson_value_free_with(YacJSONValue *value, const YacDocAllocator *allocator);
 
-YacJSONObjectIterator *yacjson_object_iterator_new(YacJSONObject *object);
-YacJSONArrayIterator *yacjson_array_iterator_new(YacJSONArray *array);
-void yacjson_object_iterator_free(YacJSONObjectIterator *it);
-void yacjson_array_iterator_free(YacJSONArrayIterator *it);
+// Iterators are initialized in place, typically on the stack, and need no
+// freeing. Object items come in insertion order
+void yacjson_object_iterator_init(YacJSONObjectIterator *it, YacJSONObject *object);
+void yacjson_array_iterator_init(YacJSONArrayIterator *it, YacJSONArray *array);
 YacJSONObjectItem *yacjson_object_iterator_next(YacJSONObjectIterator *it);
 YacJSONArrayItem *yacjson_array_iterator_next(YacJSONArrayIterator *it);
 char *yacjson_object_item_key(YacJSONObjectItem *item);
@@ -64,6 +166,11 @@ bool yacjson_value_to_boolean(YacJSONValue *value);
 long yacjson_value_to_integer(YacJSONValue *value);
 double yacjson_value_to_decimal(YacJSONValue *value);
 char *yacjson_value_to_string(YacJSONValue *value);
+size_t yacjson_value_string_length(YacJSONValue *value);
+void yacjson_value_resolve_strings(YacJSONValue *value);
+size_t yacjson_string_unescape(char *data, size_t len);
+char *yacjson_key_unescape(const char *key, size_t *len);
+size_t yacjson_string_escape(char *out, const char *data, size_t len);
 
 YacJSONValue *yacjson_value_from_object(YacJSONObject *object);
 YacJSONValue *yacjson_value_from_array(YacJSONArray *array);
@@ -71,6 +178,7 @@ YacJSONValue *yacjson_value_from_boolean(bool boolean);
 YacJSONValue *yacjson_value_from_integer(long integer);
 YacJSONValue *yacjson_value_from_decimal(double decimal);
 YacJSONValue *yacjson_value_from_string(char *string);
+YacJSONValue *yacjson_value_from_string_length(const char *string, size_t len);
 
 int yacjson_object_size(YacJSONObject *object);
 int yacjson_array_size(YacJSONArray *array);
@@ -105,7 +213,51 @@ long yacjson_array_get_integer(YacJSONArray *array, int index);
 double yacjson_array_get_decimal(YacJSONArray *array, int index);
 char *yacjson_array_get_string(YacJSONArray *array, int index);
 
+YacJSONArrayPacking yacjson_array_packing(YacJSONArray *array);
+long *yacjson_array_as_longs(YacJSONArray *array);
+double *yacjson_array_as_doubles(YacJSONArray *array);
+uint64_t *yacjson_array_as_bits(YacJSONArray *array);
+YacJSONArray *yacjson_array_from_longs(const long *values, int count);
+YacJSONArray *yacjson_array_from_doubles(const double *values, int count);
+YacJSONArray *yacjson_array_from_booleans(const bool *values, int count);
+YacJSONArray *yacjson_array_from_longs_with(const long *values, int count, const YacDocAllocator *allocator);
+YacJSONArray *yacjson_array_from_doubles_with(const double *values, int count, const YacDocAllocator *allocator);
+YacJSONArray *yacjson_array_from_booleans_with(const bool *values, int count, const YacDocAllocator *allocator);
+
 YacJSONValue *yacjson_parse(const char *filepath);
+YacJSONValue *yacjson_parse_with(const char *filepath, const YacDocAllocator *allocator);
+YacJSONValue *yacjson_parse_buffer(const char *data, size_t len);
+YacJSONValue *yacjson_parse_buffer_with(const char *data, size_t len, const YacDocAllocator *allocator);
+YacJSONValue *yacjson_parse_mmap(const char *filepath);
+YacJSONParser *yacjson_parser_new();
+YacJSONParser *yacjson_parser_new_with(const YacDocAllocator *allocator);
+bool yacjson_parser_feed(YacJSONParser *parser, const char *data, size_t len);
+YacJSONValue *yacjson_parser_finish(YacJSONParser *parser);
+YacJSONTreeBuilder *yacjson_tree_builder_new();
+YacJSONTreeBuilder *yacjson_tree_builder_new_with(const YacDocAllocator *allocator);
+void yacjson_tree_builder_free(YacJSONTreeBuilder *builder);
+const YacJSONSaxHandler *yacjson_tree_builder_sax_handler();
+YacJSONValue *yacjson_tree_builder_take(YacJSONTreeBuilder *builder);
+
+YacJSONDocument *yacjson_document_parse(const char *filepath);
+YacJSONDocument *yacjson_document_parse_buffer(const char *data, size_t len);
+YacJSONDocument *yacjson_document_parse_mmap(const char *filepath);
+YacJSONDocument *yacjson_document_parse_insitu(char *data, size_t len);
+void yacjson_document_free(YacJSONDocument *doc);
+YacJSONValue *yacjson_document_root(YacJSONDocument *doc);
+YacJSONObject *yacjson_document_object_new(YacJSONDocument *doc);
+YacJSONArray *yacjson_document_array_new(YacJSONDocument *doc);
+
 void yacjson_serialize(YacJSONValue *value, const char *filepath);
+char *yacjson_serialize_to_buffer(YacJSONValue *value, const YacJSONSerializeOptions *options, size_t *len);
+bool yacjson_serialize_to_fd(YacJSONValue *value, int fd, const YacJSONSerializeOptions *options);
+void yacjson_serialize_parallel(YacJSONValue *value, const char *filepath, int threads);
+char *yacjson_serialize_to_buffer_parallel(YacJSONValue *value, const YacJSONSerializeOptions *options, int threads, size_t *len);
+bool yacjson_serialize_to_fd_parallel(YacJSONValue *value, int fd, const YacJSONSerializeOptions *options, int threads);
+YacJSONSerializeCache *yacjson_serialize_cache_new(YacJSONValue *root, const YacJSONSerializeOptions *options);
+void yacjson_serialize_cache_free(YacJSONSerializeCache *cache);
+const char *yacjson_serialize_cache_update(YacJSONSerializeCache *cache, size_t *len);
+void yacjson_object_mark_dirty(YacJSONObject *object);
+void yacjson_array_mark_dirty(YacJSONArray *array);
 
 #endif
@@ -0,0 +1,387 @@
+// Generates typed decoders and encoders from a schema:
+//
+//   yacjson-gen schema.json out
+//
+// writes out.h and out.c. The schema is an array of struct types, each used
+// only after it is declared:
+//
+//   [
+//       {"name": "Geo", "fields": [
+//           {"key": "lat", "type": "decimal"},
+//           {"key": "lon", "type": "decimal"}
+//       ]},
+//       {"name": "Record", "fields": [
+//           {"key": "id", "type": "integer"},
+//           {"key": "tags", "type": "[string]"},
+//           {"key": "geo", "type": "Geo"},
+//           {"key": "class", "member": "klass", "type": "string"}
+//       ]}
+//   ]
+//
+// Field types are boolean (bool), integer (long), decimal (double), string
+// (char *) or a declared type (the struct, inline), and [type] for an array of
+// one of these (a pointer to the elements plus an int <member>_count). Every
+// type Name gets name_decode, name_decode_array, name_free, name_free_array
+// and name_encode, with name the snake case of Name
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "yacjson-core.h"
+#include "yacjson-schema.h"
+
+#define YACJSON_GEN_MAX_TYPES (256)
+
+typedef struct {
+    char *key;
+    size_t key_len;
+    char *member;
+    YacJSONSchemaKind kind;
+    bool is_array;
+    int type;
+} YacJSONGenField;
+
+typedef struct {
+    char *name;
+    char *prefix;
+    YacJSONGenField fields[YACJSON_SCHEMA_MAX_FIELDS];
+    int count;
+    int depth;
+} YacJSONGenType;
+
+typedef struct {
+    YacJSONGenType types[YACJSON_GEN_MAX_TYPES];
+    int count;
+} YacJSONGenSchema;
+
+static void yacjson_gen_fail(const char *message, const char *detail) {
+    fprintf(stderr, "yacjson-gen: %s%s%s\n", message, detail != NULL ? ": " : "", detail != NULL ? detail : "");
+    exit(EXIT_FAILURE);
+}
+
+static bool yacjson_gen_is_identifier(const char *name) {
+    if (!(*name == '_' || (*name >= 'a' && *name <= 'z') || (*name >= 'A' && *name <= 'Z'))) return false;
+    for (name++; *name != '\0'; name++) {
+        if (!(*name == '_' || (*name >= 'a' && *name <= 'z') || (*name >= 'A' && *name <= 'Z') || (*name >= '0' && *name <= '9'))) return false;
+    }
+    return true;
+}
+
+// GeoPoint becomes geo_point
+static char *yacjson_gen_snake_case(const char *name) {
+    size_t len = strlen(name);
+    char *out = malloc(2 * len + 1), *ptr = out;
+    for (size_t i = 0; i < len; i++) {
+        bool is_upper = name[i] >= 'A' && name[i] <= 'Z';
+        bool is_after_lower = i > 0 && ((name[i - 1] >= 'a' && name[i - 1] <= 'z') || (name[i - 1] >= '0' && name[i - 1] <= '9'));
+        if (is_upper && is_after_lower) *ptr++ = '_';
+        *ptr++ = is_upper ? name[i] - 'A' + 'a' : name[i];
+    }
+    *ptr = '\0';
+    return out;
+}
+
+static int yacjson_gen_find_type(YacJSONGenSchema *schema, const char *name) {
+    for (int i = 0; i < schema->count; i++) {
+        if (!strcmp(schema->types[i].name, name)) return i;
+    }
+    return -1;
+}
+
+static char *yacjson_gen_string(YacJSONObject *object, const char *key, const char *what) {
+    YacJSONValue *value = yacjson_object_get(object, key);
+    if (value == NULL || !yacjson_value_is_string(value)) yacjson_gen_fail("missing string", what);
+    return yacjson_value_to_string(value);
+}
+
+static void yacjson_gen_parse_field(YacJSONGenSchema *schema, YacJSONGenType *type, YacJSONValue *value) {
+    if (!yacjson_value_is_object(value)) yacjson_gen_fail("field is not an object in", type->name);
+    YacJSONObject *object = yacjson_value_to_object(value);
+    if (type->count == YACJSON_SCHEMA_MAX_FIELDS) yacjson_gen_fail("too many fields in", type->name);
+    YacJSONGenField *field = &type->fields[type->count++];
+    // Keys are matched against the raw input, so they are kept escaped
+    char *key = yacjson_gen_string(object, "key", type->name);
+    field->key = malloc(6 * strlen(key) + 1);
+    field->key_len = yacjson_string_escape(field->key, key, strlen(key));
+    field->key[field->key_len] = '\0';
+    field->member = yacjson_object_get(object, "member") != NULL ? yacjson_gen_string(object, "member", key) : key;
+    if (!yacjson_gen_is_identifier(field->member)) yacjson_gen_fail("invalid member name", field->member);
+    for (int i = 0; i < type->count - 1; i++) {
+        if (!strcmp(type->fields[i].key, field->key)) yacjson_gen_fail("duplicate key", key);
+        if (!strcmp(type->fields[i].member, field->member)) yacjson_gen_fail("duplicate member", field->member);
+    }
+    char *name = yacjson_gen_string(object, "type", key);
+    size_t len = strlen(name);
+    field->is_array = len >= 2 && name[0] == '[' && name[len - 1] == ']';
+    if (field->is_array) {
+        name = strndup(name + 1, len - 2);
+    }
+    field->type = -1;
+    if (!strcmp(name, "boolean")) {
+        field->kind = YACJSON_SCHEMA_BOOLEAN;
+    } else if (!strcmp(name, "integer")) {
+        field->kind = YACJSON_SCHEMA_INTEGER;
+    } else if (!strcmp(name, "decimal")) {
+        field->kind = YACJSON_SCHEMA_DECIMAL;
+    } else if (!strcmp(name, "string")) {
+        field->kind = YACJSON_SCHEMA_STRING;
+    } else {
+        field->kind = YACJSON_SCHEMA_STRUCT;
+        field->type = yacjson_gen_find_type(schema, name);
+        if (field->type < 0) yacjson_gen_fail("unknown or not yet declared type", name);
+    }
+    int depth = field->kind == YACJSON_SCHEMA_STRUCT ? schema->types[field->type].depth : 0;
+    if (field->is_array) depth++;
+    if (1 + depth > type->depth) type->depth = 1 + depth;
+}
+
+static void yacjson_gen_parse_schema(YacJSONGenSchema *schema, YacJSONValue *root) {
+    if (root == NULL || !yacjson_value_is_array(root)) yacjson_gen_fail("schema is not an array of types", NULL);
+    YacJSONArray *array = yacjson_value_to_array(root);
+    schema->count = 0;
+    for (int i = 0; i < yacjson_array_size(array); i++) {
+        YacJSONValue *value = yacjson_array_get(array, i);
+        if (!yacjson_value_is_object(value)) yacjson_gen_fail("type is not an object", NULL);
+        YacJSONObject *object = yacjson_value_to_object(value);
+        if (schema->count == YACJSON_GEN_MAX_TYPES) yacjson_gen_fail("too many types", NULL);
+        YacJSONGenType *type = &schema->types[schema->count];
+        type->name = yacjson_gen_string(object, "name", "type name");
+        if (!yacjson_gen_is_identifier(type->name)) yacjson_gen_fail("invalid type name", type->name);
+        if (yacjson_gen_find_type(schema, type->name) >= 0) yacjson_gen_fail("duplicate type", type->name);
+        type->prefix = yacjson_gen_snake_case(type->name);
+        type->count = 0;
+        type->depth = 1;
+        YacJSONArray *fields = yacjson_object_get_array(object, "fields");
+        if (fields == NULL) yacjson_gen_fail("missing fields array", type->name);
+        for (int j = 0; j < yacjson_array_size(fields); j++) {
+            yacjson_gen_parse_field(schema, type, yacjson_array_get(fields, j));
+        }
+        // Decoding an array of the type takes one more level
+        if (type->depth + 1 > YACJSON_SCHEMA_MAX_DEPTH) yacjson_gen_fail("type nests too deep", type->name);
+        schema->count++;
+    }
+}
+
+static const char *yacjson_gen_kind_name(YacJSONSchemaKind kind) {
+    switch (kind) {
+        case YACJSON_SCHEMA_BOOLEAN:
+            return "YACJSON_SCHEMA_BOOLEAN";
+        case YACJSON_SCHEMA_INTEGER:
+            return "YACJSON_SCHEMA_INTEGER";
+        case YACJSON_SCHEMA_DECIMAL:
+            return "YACJSON_SCHEMA_DECIMAL";
+        case YACJSON_SCHEMA_STRING:
+            return "YACJSON_SCHEMA_STRING";
+        default:
+            return "YACJSON_SCHEMA_STRUCT";
+    }
+}
+
+static const char *yacjson_gen_c_type(YacJSONGenSchema *schema, YacJSONGenField *field) {
+    switch (field->kind) {
+        case YACJSON_SCHEMA_BOOLEAN:
+            return "bool ";
+        case YACJSON_SCHEMA_INTEGER:
+            return "long ";
+        case YACJSON_SCHEMA_DECIMAL:
+            return "double ";
+        case YACJSON_SCHEMA_STRING:
+            return "char *";
+        default:
+            return schema->types[field->type].name;
+    }
+}
+
+// Octal escapes, unlike hex ones, cannot swallow the characters after them
+static void yacjson_gen_write_literal(FILE *out, const char *data, size_t len) {
+    fputc('"', out);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = data[i];
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c >= 0x20 && c < 0x7F && c != '?') {
+            fputc(c, out);
+        } else {
+            fprintf(out, "\\%03o", c);
+        }
+    }
+    fputc('"', out);
+}
+
+static void yacjson_gen_write_char(FILE *out, unsigned char c) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_') {
+        fprintf(out, "'%c'", c);
+    } else {
+        fprintf(out, "%d", (char) c);
+    }
+}
+
+static void yacjson_gen_write_compare(FILE *out, YacJSONGenField *field, int index, const char *indent) {
+    fprintf(out, "%sif (!memcmp(key, ", indent);
+    yacjson_gen_write_literal(out, field->key, field->key_len);
+    fprintf(out, ", %zu)) return %d;\n", field->key_len, index);
+}
+
+// Keys are told apart by their length first, then among keys of one length by
+// the first position where all of them differ, so a lookup is two jumps and
+// one memcmp. Groups without such a position compare key by key
+static void yacjson_gen_write_match(FILE *out, YacJSONGenType *type) {
+    fprintf(out, "static int %s_match(const char *key, size_t len) {\n", type->prefix);
+    fprintf(out, "    switch (len) {\n");
+    bool is_done[YACJSON_SCHEMA_MAX_FIELDS] = {false};
+    for (int i = 0; i < type->count; i++) {
+        if (is_done[i]) continue;
+        size_t len = type->fields[i].key_len;
+        int group[YACJSON_SCHEMA_MAX_FIELDS], count = 0;
+        for (int j = i; j < type->count; j++) {
+            if (type->fields[j].key_len != len) continue;
+            group[count++] = j;
+            is_done[j] = true;
+        }
+        fprintf(out, "        case %zu:\n", len);
+        long position = -1;
+        for (size_t p = 0; count > 1 && p < len && position < 0; p++) {
+            bool is_unique = true;
+            for (int a = 0; a < count && is_unique; a++) {
+                for (int b = a + 1; b < count && is_unique; b++) {
+                    is_unique = type->fields[group[a]].key[p] != type->fields[group[b]].key[p];
+                }
+            }
+            if (is_unique) position = p;
+        }
+        if (position < 0) {
+            for (int a = 0; a < count; a++) yacjson_gen_write_compare(out, &type->fields[group[a]], group[a], "            ");
+            fprintf(out, "            return -1;\n");
+            continue;
+        }
+        fprintf(out, "            switch (key[%ld]) {\n", position);
+        for (int a = 0; a < count; a++) {
+            fprintf(out, "                case ");
+            yacjson_gen_write_char(out, type->fields[group[a]].key[position]);
+            fprintf(out, ":\n");
+            yacjson_gen_write_compare(out, &type->fields[group[a]], group[a], "                    ");
+            fprintf(out, "                    return -1;\n");
+        }
+        fprintf(out, "            }\n");
+        fprintf(out, "            return -1;\n");
+    }
+    fprintf(out, "    }\n");
+    fprintf(out, "    return -1;\n");
+    fprintf(out, "}\n\n");
+}
+
+static void yacjson_gen_write_header(FILE *out, YacJSONGenSchema *schema, const char *guard) {
+    fprintf(out, "// Generated by yacjson-gen, do not edit\n");
+    fprintf(out, "#ifndef %s\n#define %s\n\n", guard, guard);
+    fprintf(out, "#include <stdbool.h>\n#include <stddef.h>\n\n#include \"yacjson-schema.h\"\n\n");
+    for (int i = 0; i < schema->count; i++) {
+        YacJSONGenType *type = &schema->types[i];
+        fprintf(out, "typedef struct {\n");
+        for (int j = 0; j < type->count; j++) {
+            YacJSONGenField *field = &type->fields[j];
+            const char *c_type = yacjson_gen_c_type(schema, field);
+            bool is_spaced = c_type[strlen(c_type) - 1] == ' ' || c_type[strlen(c_type) - 1] == '*';
+            fprintf(out, "    %s%s%s%s;\n", c_type, is_spaced ? "" : " ", field->is_array ? "*" : "", field->member);
+            if (field->is_array) fprintf(out, "    int %s_count;\n", field->member);
+        }
+        fprintf(out, "} %s;\n\n", type->name);
+    }
+    for (int i = 0; i < schema->count; i++) {
+        YacJSONGenType *type = &schema->types[i];
+        const char *name = type->name, *prefix = type->prefix;
+        fprintf(out, "extern const YacJSONSchemaType %s_type;\n", prefix);
+        fprintf(out, "bool %s_decode(const char *data, size_t len, %s *out);\n", prefix, name);
+        fprintf(out, "bool %s_decode_array(const char *data, size_t len, %s **items, int *count);\n", prefix, name);
+        fprintf(out, "void %s_free(%s *value);\n", prefix, name);
+        fprintf(out, "void %s_free_array(%s *items, int count);\n", prefix, name);
+        fprintf(out, "char *%s_encode(const %s *value, size_t *len);\n\n", prefix, name);
+    }
+    fprintf(out, "#endif\n");
+}
+
+static void yacjson_gen_write_source(FILE *out, YacJSONGenSchema *schema, const char *header) {
+    fprintf(out, "// Generated by yacjson-gen, do not edit\n");
+    fprintf(out, "#include <stdbool.h>\n#include <stddef.h>\n#include <string.h>\n\n");
+    fprintf(out, "#include \"%s\"\n#include \"yacjson-schema.h\"\n\n", header);
+    for (int i = 0; i < schema->count; i++) {
+        YacJSONGenType *type = &schema->types[i];
+        const char *name = type->name, *prefix = type->prefix;
+        yacjson_gen_write_match(out, type);
+        fprintf(out, "static const YacJSONSchemaField %s_fields[] = {\n", prefix);
+        for (int j = 0; j < type->count; j++) {
+            YacJSONGenField *field = &type->fields[j];
+            fprintf(out, "    {");
+            yacjson_gen_write_literal(out, field->key, field->key_len);
+            fprintf(out, ", %zu, %s, %s, offsetof(%s, %s), ", field->key_len, yacjson_gen_kind_name(field->kind), field->is_array ? "true" : "false", name, field->member);
+            if (field->is_array) {
+                fprintf(out, "offsetof(%s, %s_count), ", name, field->member);
+            } else {
+                fprintf(out, "0, ");
+            }
+            if (field->type >= 0) {
+                fprintf(out, "&%s_type},\n", schema->types[field->type].prefix);
+            } else {
+                fprintf(out, "NULL},\n");
+            }
+        }
+        if (type->count == 0) fprintf(out, "    {NULL, 0, YACJSON_SCHEMA_BOOLEAN, false, 0, 0, NULL},\n");
+        fprintf(out, "};\n\n");
+        fprintf(out, "const YacJSONSchemaType %s_type = {\"%s\", sizeof(%s), %s_fields, %d, %s_match};\n\n", prefix, name, name, prefix, type->count, prefix);
+        fprintf(out, "bool %s_decode(const char *data, size_t len, %s *out) {\n", prefix, name);
+        fprintf(out, "    return yacjson_schema_decode(&%s_type, data, len, out);\n}\n\n", prefix);
+        fprintf(out, "bool %s_decode_array(const char *data, size_t len, %s **items, int *count) {\n", prefix, name);
+        fprintf(out, "    return yacjson_schema_decode_array(&%s_type, data, len, (void **) items, count);\n}\n\n", prefix);
+        fprintf(out, "void %s_free(%s *value) {\n", prefix, name);
+        fprintf(out, "    yacjson_schema_free(&%s_type, value);\n}\n\n", prefix);
+        fprintf(out, "void %s_free_array(%s *items, int count) {\n", prefix, name);
+        fprintf(out, "    yacjson_schema_free_array(&%s_type, items, count);\n}\n\n", prefix);
+        fprintf(out, "char *%s_encode(const %s *value, size_t *len) {\n", prefix, name);
+        fprintf(out, "    return yacjson_schema_encode(&%s_type, value, len);\n}\n", prefix);
+        if (i < schema->count - 1) fprintf(out, "\n");
+    }
+}
+
+static FILE *yacjson_gen_open(const char *base, const char *extension, char **path) {
+    *path = malloc(strlen(base) + strlen(extension) + 1);
+    strcpy(*path, base);
+    strcat(*path, extension);
+    FILE *file = fopen(*path, "w");
+    if (file == NULL) yacjson_gen_fail("cannot write", *path);
+    return file;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s schema.json output\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    FILE *input = fopen(argv[1], "rb");
+    if (input == NULL) yacjson_gen_fail("cannot read", argv[1]);
+    fclose(input);
+    YacJSONValue *root = yacjson_parse(argv[1]);
+    static YacJSONGenSchema schema;
+    yacjson_gen_parse_schema(&schema, root);
+
+    const char *base = strrchr(argv[2], '/') != NULL ? strrchr(argv[2], '/') + 1 : argv[2];
+    char *guard = malloc(strlen(base) + 3);
+    size_t len = 0;
+    for (const char *ptr = base; *ptr != '\0'; ptr++) {
+        bool is_alnum = (*ptr >= 'a' && *ptr <= 'z') || (*ptr >= 'A' && *ptr <= 'Z') || (*ptr >= '0' && *ptr <= '9');
+        guard[len++] = !is_alnum ? '_' : (*ptr >= 'a' && *ptr <= 'z') ? *ptr - 'a' + 'A' : *ptr;
+    }
+    strcpy(guard + len, "_H");
+
+    char *header_path, *source_path;
+    FILE *header = yacjson_gen_open(argv[2], ".h", &header_path);
+    yacjson_gen_write_header(header, &schema, guard);
+    FILE *source = yacjson_gen_open(argv[2], ".c", &source_path);
+    char *header_name = malloc(strlen(base) + 3);
+    strcpy(header_name, base);
+    strcat(header_name, ".h");
+    yacjson_gen_write_source(source, &schema, header_name);
+    if (fclose(header) != 0 || fclose(source) != 0) yacjson_gen_fail("cannot write", argv[2]);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,236 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define YACJSON_INDEX_X86
+#include <immintrin.h>
+#endif
+
+#include "bits.h"
+#include "yacjson-index.h"
+
+enum {
+    YACJSON_CLASS_QUOTE = 1,
+    YACJSON_CLASS_BACKSLASH = 2,
+    YACJSON_CLASS_OP = 4,
+    YACJSON_CLASS_WHITESPACE = 8,
+};
+
+static const unsigned char yacjson_char_classes[256] = {
+    ['"'] = YACJSON_CLASS_QUOTE,
+    ['\\'] = YACJSON_CLASS_BACKSLASH,
+    ['{'] = YACJSON_CLASS_OP,
+    ['}'] = YACJSON_CLASS_OP,
+    ['['] = YACJSON_CLASS_OP,
+    [']'] = YACJSON_CLASS_OP,
+    [':'] = YACJSON_CLASS_OP,
+    [','] = YACJSON_CLASS_OP,
+    [' '] = YACJSON_CLASS_WHITESPACE,
+    ['\t'] = YACJSON_CLASS_WHITESPACE,
+    ['\n'] = YACJSON_CLASS_WHITESPACE,
+    ['\r'] = YACJSON_CLASS_WHITESPACE,
+};
+
+static void yacjson_classify_scalar(const char *block, YacJSONBlockMasks *masks) {
+    uint64_t quote = 0, backslash = 0, op = 0, whitespace = 0;
+    for (int i = 0; i < YACJSON_INDEX_BLOCK_LEN; i++) {
+        uint64_t cls = yacjson_char_classes[(unsigned char) block[i]];
+        quote |= (cls & 1) << i;
+        backslash |= (cls >> 1 & 1) << i;
+        op |= (cls >> 2 & 1) << i;
+        whitespace |= (cls >> 3 & 1) << i;
+    }
+    masks->quote = quote;
+    masks->backslash = backslash;
+    masks->op = op;
+    masks->whitespace = whitespace;
+}
+
+#ifdef YACJSON_INDEX_X86
+
+// '[' and ']' differ from '{' and '}' only in bit 0x20, so four compares find all six ops
+
+#ifdef __SSE2__
+static void yacjson_classify_sse2(const char *block, YacJSONBlockMasks *masks) {
+    memset(masks, 0, sizeof(YacJSONBlockMasks));
+    for (int i = 0; i < YACJSON_INDEX_BLOCK_LEN; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (block + i));
+        __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        masks->quote |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << i;
+        masks->backslash |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << i;
+        masks->op |= (uint64_t) (uint16_t) _mm_movemask_epi8(op) << i;
+        masks->whitespace |= (uint64_t) (uint16_t) _mm_movemask_epi8(ws) << i;
+    }
+}
+#endif
+
+__attribute__((target("avx2"))) static uint64_t yacjson_movemask_avx2(__m256i lo, __m256i hi) {
+    return (uint64_t) (uint32_t) _mm256_movemask_epi8(lo) | (uint64_t) (uint32_t) _mm256_movemask_epi8(hi) << 32;
+}
+
+__attribute__((target("avx2"))) static __m256i yacjson_op_avx2(__m256i v) {
+    __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+}
+
+__attribute__((target("avx2"))) static __m256i yacjson_whitespace_avx2(__m256i v) {
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+}
+
+__attribute__((target("avx2"))) static void yacjson_classify_avx2(const char *block, YacJSONBlockMasks *masks) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *) block);
+    __m256i hi = _mm256_loadu_si256((const __m256i *) (block + 32));
+    __m256i quote = _mm256_set1_epi8('"');
+    __m256i backslash = _mm256_set1_epi8('\\');
+    masks->quote = yacjson_movemask_avx2(_mm256_cmpeq_epi8(lo, quote), _mm256_cmpeq_epi8(hi, quote));
+    masks->backslash = yacjson_movemask_avx2(_mm256_cmpeq_epi8(lo, backslash), _mm256_cmpeq_epi8(hi, backslash));
+    masks->op = yacjson_movemask_avx2(yacjson_op_avx2(lo), yacjson_op_avx2(hi));
+    masks->whitespace = yacjson_movemask_avx2(yacjson_whitespace_avx2(lo), yacjson_whitespace_avx2(hi));
+}
+
+#endif
+
+static YacJSONClassifyFunc yacjson_select_classify() {
+#ifdef YACJSON_INDEX_X86
+    if (__builtin_cpu_supports("avx2")) return yacjson_classify_avx2;
+#ifdef __SSE2__
+    return yacjson_classify_sse2;
+#endif
+#endif
+    return yacjson_classify_scalar;
+}
+
+static uint64_t yacjson_prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+static int yacjson_popcount(uint64_t bits) {
+#ifdef __GNUC__
+    return __builtin_popcountll(bits);
+#else
+    int count = 0;
+    while (bits != 0) {
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Marks the characters preceded by an odd-length run of backslashes
+static uint64_t yacjson_find_escaped(YacJSONTokenizer *tokenizer, uint64_t backslash) {
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    backslash &= ~tokenizer->prev_escaped;
+    uint64_t follows_escape = backslash << 1 | tokenizer->prev_escaped;
+    uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+    uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    tokenizer->prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts;
+    uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (even_bits ^ invert_mask) & follows_escape;
+}
+
+static uint64_t yacjson_scan_block(YacJSONTokenizer *tokenizer, const char *block) {
+    YacJSONBlockMasks masks;
+    tokenizer->classify(block, &masks);
+    uint64_t escaped = yacjson_find_escaped(tokenizer, masks.backslash);
+    uint64_t quote = masks.quote & ~escaped;
+    uint64_t in_string = yacjson_prefix_xor(quote) ^ tokenizer->prev_in_string;
+    tokenizer->prev_in_string = (uint64_t) 0 - (in_string >> 63);
+    uint64_t string_tail = in_string ^ quote;
+    uint64_t scalar = ~(masks.op | masks.whitespace);
+    uint64_t nonquote_scalar = scalar & ~quote;
+    uint64_t follows_nonquote_scalar = nonquote_scalar << 1 | tokenizer->prev_scalar;
+    tokenizer->prev_scalar = nonquote_scalar >> 63;
+    uint64_t closing_quote = quote & ~in_string;
+    return ((masks.op | (scalar & ~follows_nonquote_scalar)) & ~string_tail) | closing_quote;
+}
+
+// Writes positions four at a time and then trims the overshoot, which keeps
+// the loop branch predictable on dense blocks
+static void yacjson_flatten_bits(YacJSONTokenizer *tokenizer, uint64_t bits) {
+    size_t *out = tokenizer->positions + tokenizer->count;
+    size_t base = tokenizer->offset;
+    int count = 0;
+    tokenizer->count += yacjson_popcount(bits);
+    while (bits != 0) {
+        out[count] = base + yacdoc_trailing_zeros(bits);
+        bits &= bits - 1;
+        out[count + 1] = base + yacdoc_trailing_zeros(bits | (uint64_t) 1 << 63);
+        bits &= bits - 1;
+        out[count + 2] = base + yacdoc_trailing_zeros(bits | (uint64_t) 1 << 63);
+        bits &= bits - 1;
+        out[count + 3] = base + yacdoc_trailing_zeros(bits | (uint64_t) 1 << 63);
+        bits &= bits - 1;
+        count += 4;
+    }
+}
+
+static void yacjson_tokenizer_fill(YacJSONTokenizer *tokenizer) {
+    tokenizer->count = 0;
+    tokenizer->next = 0;
+    while (tokenizer->offset < tokenizer->len && tokenizer->count + YACJSON_INDEX_BLOCK_LEN + 4 <= YACJSON_INDEX_BATCH_LEN) {
+        uint64_t structurals;
+        size_t remaining = tokenizer->len - tokenizer->offset;
+        if (remaining >= YACJSON_INDEX_BLOCK_LEN) {
+            structurals = yacjson_scan_block(tokenizer, tokenizer->data + tokenizer->offset);
+        } else {
+            char block[YACJSON_INDEX_BLOCK_LEN];
+            memset(block, ' ', YACJSON_INDEX_BLOCK_LEN);
+            memcpy(block, tokenizer->data + tokenizer->offset, remaining);
+            structurals = yacjson_scan_block(tokenizer, block);
+            structurals &= ((uint64_t) 1 << remaining) - 1;
+        }
+        yacjson_flatten_bits(tokenizer, structurals);
+        tokenizer->offset += YACJSON_INDEX_BLOCK_LEN;
+    }
+    if (tokenizer->offset > tokenizer->len) tokenizer->offset = tokenizer->len;
+}
+
+void yacjson_tokenizer_init(YacJSONTokenizer *tokenizer, const char *data, size_t len) {
+    tokenizer->data = data;
+    tokenizer->len = len;
+    tokenizer->offset = 0;
+    tokenizer->prev_escaped = 0;
+    tokenizer->prev_in_string = 0;
+    tokenizer->prev_scalar = 0;
+    tokenizer->classify = yacjson_select_classify();
+    tokenizer->count = 0;
+    tokenizer->next = 0;
+}
+
+bool yacjson_tokenizer_peek(YacJSONTokenizer *tokenizer, size_t *position) {
+    while (tokenizer->next == tokenizer->count) {
+        if (tokenizer->offset == tokenizer->len) return false;
+        yacjson_tokenizer_fill(tokenizer);
+    }
+    *position = tokenizer->positions[tokenizer->next];
+    return true;
+}
+
+bool yacjson_tokenizer_next(YacJSONTokenizer *tokenizer, size_t *position) {
+    if (!yacjson_tokenizer_peek(tokenizer, position)) return false;
+    tokenizer->next++;
+    return true;
+}
+
+bool yacjson_tokenizer_in_string(YacJSONTokenizer *tokenizer) {
+    return tokenizer->prev_in_string != 0;
+}
@@ -0,0 +1,41 @@
+#ifndef YACJSON_INDEX_H
+#define YACJSON_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define YACJSON_INDEX_BLOCK_LEN (64)
+#define YACJSON_INDEX_BATCH_LEN (1024)
+
+typedef struct {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;
+    uint64_t whitespace;
+} YacJSONBlockMasks;
+
+typedef void (* YacJSONClassifyFunc)(const char *block, YacJSONBlockMasks *masks);
+
+// Streams the offsets of structural characters ({}[]:,), both quotes of every
+// string and scalar starts over a contiguous buffer, one batch of 64-byte
+// blocks at a time
+typedef struct {
+    const char *data;
+    size_t len;
+    size_t offset;
+    uint64_t prev_escaped;
+    uint64_t prev_in_string;
+    uint64_t prev_scalar;
+    YacJSONClassifyFunc classify;
+    size_t count;
+    size_t next;
+    size_t positions[YACJSON_INDEX_BATCH_LEN];
+} YacJSONTokenizer;
+
+void yacjson_tokenizer_init(YacJSONTokenizer *tokenizer, const char *data, size_t len);
+bool yacjson_tokenizer_next(YacJSONTokenizer *tokenizer, size_t *position);
+bool yacjson_tokenizer_peek(YacJSONTokenizer *tokenizer, size_t *position);
+bool yacjson_tokenizer_in_string(YacJSONTokenizer *tokenizer);
+
+#endif
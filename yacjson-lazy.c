@@ -0,0 +1,505 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "mapfile.h"
+#include "yacjson-core.h"
+#include "yacjson-index.h"
+#include "yacjson-lazy.h"
+#include "yacjson-sax.h"
+
+// Objects up to this size are searched linearly, larger ones get a hash index
+#define YACJSON_LAZY_MAX_LINEAR_SIZE (8)
+#define YACJSON_LAZY_NO_MATCH ((size_t) -1)
+
+static uint64_t yacjson_lazy_hash(const char *key, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) key[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static char yacjson_lazy_char(YacJSONLazyDocument *doc, size_t token) {
+    return doc->data[doc->positions[token]];
+}
+
+// Collects every indexed position and pairs up the brackets; fails on
+// unbalanced or mismatched brackets and on an unterminated string
+static bool yacjson_lazy_index(YacJSONLazyDocument *doc) {
+    YacJSONTokenizer tokenizer;
+    size_t capacity = 1024;
+    size_t *stack = NULL;
+    size_t depth = 0;
+    size_t stack_capacity = 0;
+    size_t position;
+    bool is_valid = true;
+    doc->positions = malloc(capacity * sizeof(size_t));
+    assert(doc->positions != NULL);
+    yacjson_tokenizer_init(&tokenizer, doc->data, doc->len);
+    while (yacjson_tokenizer_next(&tokenizer, &position)) {
+        if (doc->count == capacity) {
+            capacity *= 2;
+            doc->positions = realloc(doc->positions, capacity * sizeof(size_t));
+            assert(doc->positions != NULL);
+        }
+        doc->positions[doc->count++] = position;
+    }
+    if (yacjson_tokenizer_in_string(&tokenizer)) return false;
+    doc->match = malloc((doc->count > 0 ? doc->count : 1) * sizeof(size_t));
+    assert(doc->match != NULL);
+    for (size_t i = 0; i < doc->count && is_valid; i++) {
+        char c = yacjson_lazy_char(doc, i);
+        doc->match[i] = YACJSON_LAZY_NO_MATCH;
+        if (c == '{' || c == '[') {
+            if (depth == stack_capacity) {
+                stack_capacity = stack_capacity == 0 ? 64 : stack_capacity * 2;
+                stack = realloc(stack, stack_capacity * sizeof(size_t));
+                assert(stack != NULL);
+            }
+            stack[depth++] = i;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0 || yacjson_lazy_char(doc, stack[depth - 1]) != (c == '}' ? '{' : '[')) {
+                is_valid = false;
+            } else {
+                doc->match[stack[--depth]] = i;
+            }
+        }
+    }
+    free(stack);
+    return is_valid && depth == 0;
+}
+
+// Returns the token following the value starting at token, or
+// YACJSON_LAZY_NO_MATCH if there is no well-formed value there
+static size_t yacjson_lazy_skip(YacJSONLazyDocument *doc, size_t token, size_t end) {
+    if (token >= end) return YACJSON_LAZY_NO_MATCH;
+    switch (yacjson_lazy_char(doc, token)) {
+        case '{':
+        case '[':
+            return doc->match[token] + 1;
+        case '"':
+            return token + 2;
+        case '}':
+        case ']':
+        case ':':
+        case ',':
+            return YACJSON_LAZY_NO_MATCH;
+    }
+    return token + 1;
+}
+
+static YacJSONLazyValue *yacjson_lazy_value_new(YacJSONLazyDocument *doc, size_t token) {
+    YacJSONLazyValue *value = yacdoc_arena_alloc(doc->arena, sizeof(YacJSONLazyValue));
+    memset(value, 0, sizeof(YacJSONLazyValue));
+    value->doc = doc;
+    value->token = token;
+    switch (yacjson_lazy_char(doc, token)) {
+        case '{':
+            value->type = YACJSON_OBJECT;
+            break;
+        case '[':
+            value->type = YACJSON_ARRAY;
+            break;
+        case '"':
+            value->type = YACJSON_STRING;
+            break;
+        default:
+            value->is_scalar = true;
+            break;
+    }
+    return value;
+}
+
+static YacJSONLazyEntry *yacjson_lazy_object_find(YacJSONLazyValue *object, const char *key, size_t len, uint64_t hash) {
+    if (object->slots == NULL) {
+        for (int i = 0; i < object->size; i++) {
+            YacJSONLazyEntry *entry = &object->entries[i];
+            if (entry->key_len == len && !memcmp(entry->key, key, len)) return entry;
+        }
+        return NULL;
+    }
+    size_t slot = hash & object->slot_mask;
+    while (object->slots[slot] != 0) {
+        YacJSONLazyEntry *entry = &object->entries[object->slots[slot] - 1];
+        if (entry->hash == hash && entry->key_len == len && !memcmp(entry->key, key, len)) return entry;
+        slot = (slot + 1) & object->slot_mask;
+    }
+    return NULL;
+}
+
+// Drops later duplicates of a key, so the first occurrence wins as in the tree
+// parser, and builds the hash index for large objects
+static void yacjson_lazy_object_index(YacJSONLazyValue *object) {
+    int count = object->size;
+    object->size = 0;
+    if (count > YACJSON_LAZY_MAX_LINEAR_SIZE) {
+        size_t slot_count = 1;
+        while (slot_count < (size_t) count * 2) slot_count <<= 1;
+        object->slots = yacdoc_arena_alloc(object->doc->arena, slot_count * sizeof(int));
+        memset(object->slots, 0, slot_count * sizeof(int));
+        object->slot_mask = slot_count - 1;
+    }
+    for (int i = 0; i < count; i++) {
+        YacJSONLazyEntry entry = object->entries[i];
+        if (yacjson_lazy_object_find(object, entry.key, entry.key_len, entry.hash) != NULL) continue;
+        object->entries[object->size] = entry;
+        if (object->slots != NULL) {
+            // Slots hold entry index + 1 so that zero marks a free slot
+            size_t slot = entry.hash & object->slot_mask;
+            while (object->slots[slot] != 0) slot = (slot + 1) & object->slot_mask;
+            object->slots[slot] = object->size + 1;
+        }
+        object->size++;
+    }
+}
+
+// Decodes the direct children of a container; the children themselves stay
+// undecoded until they are accessed
+static void yacjson_lazy_decode(YacJSONLazyValue *container) {
+    YacJSONLazyDocument *doc = container->doc;
+    bool is_object = container->type == YACJSON_OBJECT;
+    size_t end = doc->match[container->token];
+    size_t token;
+    int size = 0;
+    container->is_resolved = true;
+    container->is_malformed = true;
+    for (int pass = 0; pass < 2; pass++) {
+        token = container->token + 1;
+        size = 0;
+        while (token < end) {
+            size_t value_token = token;
+            if (is_object) {
+                if (token + 3 > end || yacjson_lazy_char(doc, token) != '"' || yacjson_lazy_char(doc, token + 2) != ':') return;
+                value_token = token + 3;
+            }
+            size_t next = yacjson_lazy_skip(doc, value_token, end);
+            if (next == YACJSON_LAZY_NO_MATCH || next > end) return;
+            if (pass == 1) {
+                YacJSONLazyValue *value = yacjson_lazy_value_new(doc, value_token);
+                if (is_object) {
+                    YacJSONLazyEntry *entry = &container->entries[size];
+                    const char *key = doc->data + doc->positions[token] + 1;
+                    entry->key_len = doc->positions[token + 1] - doc->positions[token] - 1;
+                    if (memchr(key, '\\', entry->key_len) != NULL) {
+                        char *unescaped = yacdoc_arena_strndup(doc->arena, key, entry->key_len);
+                        entry->key_len = yacjson_string_unescape(unescaped, entry->key_len);
+                        key = unescaped;
+                    }
+                    entry->key = key;
+                    entry->hash = yacjson_lazy_hash(entry->key, entry->key_len);
+                    entry->value = value;
+                } else {
+                    container->items[size] = value;
+                }
+            }
+            size++;
+            if (next == end) break;
+            if (yacjson_lazy_char(doc, next) != ',' || next + 1 == end) return;
+            token = next + 1;
+        }
+        if (pass == 0) {
+            if (is_object) {
+                container->entries = yacdoc_arena_alloc(doc->arena, size * sizeof(YacJSONLazyEntry) + 1);
+            } else {
+                container->items = yacdoc_arena_alloc(doc->arena, size * sizeof(YacJSONLazyValue *) + 1);
+            }
+        }
+    }
+    container->size = size;
+    container->is_malformed = false;
+    if (is_object) yacjson_lazy_object_index(container);
+}
+
+static YacJSONSaxAction yacjson_lazy_on_boolean(void *ctx, bool boolean) {
+    YacJSONLazyValue *value = ctx;
+    value->type = YACJSON_BOOLEAN;
+    value->data.boolean = boolean;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_lazy_on_integer(void *ctx, long integer) {
+    YacJSONLazyValue *value = ctx;
+    value->type = YACJSON_INTEGER;
+    value->data.integer = integer;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_lazy_on_decimal(void *ctx, double decimal) {
+    YacJSONLazyValue *value = ctx;
+    value->type = YACJSON_DECIMAL;
+    value->data.decimal = decimal;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static void yacjson_lazy_string_copy(YacJSONLazyValue *value, const char *start, size_t len) {
+    value->data.string = yacdoc_arena_strndup(value->doc->arena, start, len);
+    value->string_len = yacjson_string_unescape(value->data.string, len);
+    value->data.string[value->string_len] = '\0';
+}
+
+static YacJSONSaxAction yacjson_lazy_on_string(void *ctx, const char *string, size_t len) {
+    YacJSONLazyValue *value = ctx;
+    value->type = YACJSON_STRING;
+    yacjson_lazy_string_copy(value, string, len);
+    return YACJSON_SAX_CONTINUE;
+}
+
+// Kept as the string "null", like in the tree parser
+static YacJSONSaxAction yacjson_lazy_on_null(void *ctx) {
+    YacJSONLazyValue *value = ctx;
+    value->type = YACJSON_STRING;
+    yacjson_lazy_string_copy(value, "null", 4);
+    return YACJSON_SAX_CONTINUE;
+}
+
+static const YacJSONSaxHandler yacjson_lazy_scalar_handler = {
+    .null = yacjson_lazy_on_null,
+    .boolean = yacjson_lazy_on_boolean,
+    .integer = yacjson_lazy_on_integer,
+    .decimal = yacjson_lazy_on_decimal,
+    .string = yacjson_lazy_on_string,
+};
+
+static void yacjson_lazy_resolve(YacJSONLazyValue *value) {
+    YacJSONLazyDocument *doc = value->doc;
+    const char *start = doc->data + doc->positions[value->token];
+    if (value->is_resolved) return;
+    if (value->is_scalar) {
+        const char *end = yacjson_sax_scalar_end(start, doc->data + doc->len);
+        YacJSONSaxResult result = yacjson_sax_scalar(&yacjson_lazy_scalar_handler, value, start, end - start);
+        value->is_malformed = result == YACJSON_SAX_ERROR;
+        value->is_resolved = true;
+    } else if (value->type == YACJSON_STRING) {
+        size_t len = doc->positions[value->token + 1] - doc->positions[value->token] - 1;
+        yacjson_lazy_string_copy(value, start + 1, len);
+        value->is_resolved = true;
+    } else {
+        yacjson_lazy_decode(value);
+    }
+}
+
+static YacJSONLazyDocument *yacjson_lazy_document_new(const char *data, size_t len) {
+    YacJSONLazyDocument *doc = malloc(sizeof(YacJSONLazyDocument));
+    assert(doc != NULL);
+    doc->file.data = NULL;
+    doc->file.len = 0;
+    doc->data = data;
+    doc->len = len;
+    doc->positions = NULL;
+    doc->match = NULL;
+    doc->count = 0;
+    doc->arena = yacdoc_arena_new();
+    doc->root = NULL;
+    if (!yacjson_lazy_index(doc) || doc->count == 0 || doc->match[0] == YACJSON_LAZY_NO_MATCH) {
+        yacjson_lazy_document_free(doc);
+        return NULL;
+    }
+    doc->root = yacjson_lazy_value_new(doc, 0);
+    return doc;
+}
+
+YacJSONLazyDocument *yacjson_lazy_document_parse_buffer(const char *data, size_t len) {
+    return yacjson_lazy_document_new(data, len);
+}
+
+YacJSONLazyDocument *yacjson_lazy_document_parse_mmap(const char *filepath) {
+    YacDocMappedFile file;
+    yacdoc_mapped_file_open(&file, filepath);
+    YacJSONLazyDocument *doc = yacjson_lazy_document_new(file.data, file.len);
+    if (doc == NULL) {
+        yacdoc_mapped_file_close(&file);
+    } else {
+        doc->file = file;
+    }
+    return doc;
+}
+
+void yacjson_lazy_document_free(YacJSONLazyDocument *doc) {
+    if (doc->file.data != NULL) yacdoc_mapped_file_close(&doc->file);
+    yacdoc_arena_free(doc->arena);
+    free(doc->positions);
+    free(doc->match);
+    free(doc);
+}
+
+// Values are only handed out once they are resolved, and malformed ones read
+// as missing: a bare token that is not a number or a word, or a container
+// whose direct children do not parse. Deeper levels are checked as they are
+// reached, so a malformed grandchild does not hide its grandparent
+static YacJSONLazyValue *yacjson_lazy_checked(YacJSONLazyValue *value) {
+    yacjson_lazy_resolve(value);
+    return value->is_malformed ? NULL : value;
+}
+
+YacJSONLazyValue *yacjson_lazy_document_root(YacJSONLazyDocument *doc) {
+    return yacjson_lazy_checked(doc->root);
+}
+
+YacJSONValueType yacjson_lazy_value_type(YacJSONLazyValue *value) {
+    yacjson_lazy_resolve(value);
+    return value->type;
+}
+
+// Copies the value into a regular heap tree owned by the caller
+YacJSONValue *yacjson_lazy_value_materialize(YacJSONLazyValue *value) {
+    YacJSONLazyDocument *doc = value->doc;
+    if (yacjson_lazy_checked(value) == NULL) return NULL;
+    switch (value->type) {
+        case YACJSON_OBJECT:
+        case YACJSON_ARRAY: {
+            size_t start = doc->positions[value->token];
+            size_t end = doc->positions[doc->match[value->token]];
+            return yacjson_parse_buffer(doc->data + start, end - start + 1);
+        }
+        case YACJSON_BOOLEAN:
+            return yacjson_value_from_boolean(value->data.boolean);
+        case YACJSON_INTEGER:
+            return yacjson_value_from_integer(value->data.integer);
+        case YACJSON_DECIMAL:
+            return yacjson_value_from_decimal(value->data.decimal);
+        case YACJSON_STRING:
+            return yacjson_value_from_string_length(value->data.string, value->string_len);
+    }
+    return NULL;
+}
+
+bool yacjson_lazy_value_to_boolean(YacJSONLazyValue *value) {
+    yacjson_lazy_resolve(value);
+    return value->data.boolean;
+}
+
+long yacjson_lazy_value_to_integer(YacJSONLazyValue *value) {
+    yacjson_lazy_resolve(value);
+    return value->data.integer;
+}
+
+double yacjson_lazy_value_to_decimal(YacJSONLazyValue *value) {
+    yacjson_lazy_resolve(value);
+    return value->data.decimal;
+}
+
+char *yacjson_lazy_value_to_string(YacJSONLazyValue *value) {
+    yacjson_lazy_resolve(value);
+    return value->data.string;
+}
+
+// The typed getters below go through these, so that a member which is
+// missing, malformed or of another type is reported instead of read
+static bool yacjson_lazy_value_get_boolean(YacJSONLazyValue *value, bool *boolean) {
+    if (value == NULL || value->type != YACJSON_BOOLEAN) return false;
+    *boolean = value->data.boolean;
+    return true;
+}
+
+static bool yacjson_lazy_value_get_integer(YacJSONLazyValue *value, long *integer) {
+    if (value == NULL || value->type != YACJSON_INTEGER) return false;
+    *integer = value->data.integer;
+    return true;
+}
+
+// Integers widen to decimals, like in the schema decoders
+static bool yacjson_lazy_value_get_decimal(YacJSONLazyValue *value, double *decimal) {
+    if (value == NULL) return false;
+    if (value->type == YACJSON_INTEGER) {
+        *decimal = (double) value->data.integer;
+    } else if (value->type == YACJSON_DECIMAL) {
+        *decimal = value->data.decimal;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool yacjson_lazy_value_get_string(YacJSONLazyValue *value, char **string) {
+    if (value == NULL || value->type != YACJSON_STRING) return false;
+    *string = value->data.string;
+    return true;
+}
+
+int yacjson_lazy_object_size(YacJSONLazyValue *object) {
+    yacjson_lazy_resolve(object);
+    return object->size;
+}
+
+int yacjson_lazy_array_size(YacJSONLazyValue *array) {
+    yacjson_lazy_resolve(array);
+    return array->size;
+}
+
+YacJSONLazyEntry *yacjson_lazy_object_entry(YacJSONLazyValue *object, int index) {
+    if (yacjson_lazy_value_type(object) != YACJSON_OBJECT) return NULL;
+    if (index < 0 || index >= object->size) return NULL;
+    YacJSONLazyEntry *entry = &object->entries[index];
+    return yacjson_lazy_checked(entry->value) != NULL ? entry : NULL;
+}
+
+YacJSONLazyValue *yacjson_lazy_object_get(YacJSONLazyValue *object, const char *key) {
+    if (object == NULL || yacjson_lazy_value_type(object) != YACJSON_OBJECT) return NULL;
+    size_t len = strlen(key);
+    YacJSONLazyEntry *entry = yacjson_lazy_object_find(object, key, len, yacjson_lazy_hash(key, len));
+    return entry != NULL ? yacjson_lazy_checked(entry->value) : NULL;
+}
+
+YacJSONLazyValue *yacjson_lazy_array_get(YacJSONLazyValue *array, int index) {
+    if (array == NULL || yacjson_lazy_value_type(array) != YACJSON_ARRAY) return NULL;
+    if (index < 0 || index >= array->size) return NULL;
+    return yacjson_lazy_checked(array->items[index]);
+}
+
+YacJSONLazyValue *yacjson_lazy_object_get_object(YacJSONLazyValue *object, const char *key) {
+    YacJSONLazyValue *value = yacjson_lazy_object_get(object, key);
+    return value != NULL && yacjson_lazy_value_type(value) == YACJSON_OBJECT ? value : NULL;
+}
+
+YacJSONLazyValue *yacjson_lazy_object_get_array(YacJSONLazyValue *object, const char *key) {
+    YacJSONLazyValue *value = yacjson_lazy_object_get(object, key);
+    return value != NULL && yacjson_lazy_value_type(value) == YACJSON_ARRAY ? value : NULL;
+}
+
+bool yacjson_lazy_object_get_boolean(YacJSONLazyValue *object, const char *key, bool *boolean) {
+    return yacjson_lazy_value_get_boolean(yacjson_lazy_object_get(object, key), boolean);
+}
+
+bool yacjson_lazy_object_get_integer(YacJSONLazyValue *object, const char *key, long *integer) {
+    return yacjson_lazy_value_get_integer(yacjson_lazy_object_get(object, key), integer);
+}
+
+bool yacjson_lazy_object_get_decimal(YacJSONLazyValue *object, const char *key, double *decimal) {
+    return yacjson_lazy_value_get_decimal(yacjson_lazy_object_get(object, key), decimal);
+}
+
+bool yacjson_lazy_object_get_string(YacJSONLazyValue *object, const char *key, char **string) {
+    return yacjson_lazy_value_get_string(yacjson_lazy_object_get(object, key), string);
+}
+
+YacJSONLazyValue *yacjson_lazy_array_get_object(YacJSONLazyValue *array, int index) {
+    YacJSONLazyValue *value = yacjson_lazy_array_get(array, index);
+    return value != NULL && yacjson_lazy_value_type(value) == YACJSON_OBJECT ? value : NULL;
+}
+
+YacJSONLazyValue *yacjson_lazy_array_get_array(YacJSONLazyValue *array, int index) {
+    YacJSONLazyValue *value = yacjson_lazy_array_get(array, index);
+    return value != NULL && yacjson_lazy_value_type(value) == YACJSON_ARRAY ? value : NULL;
+}
+
+bool yacjson_lazy_array_get_boolean(YacJSONLazyValue *array, int index, bool *boolean) {
+    return yacjson_lazy_value_get_boolean(yacjson_lazy_array_get(array, index), boolean);
+}
+
+bool yacjson_lazy_array_get_integer(YacJSONLazyValue *array, int index, long *integer) {
+    return yacjson_lazy_value_get_integer(yacjson_lazy_array_get(array, index), integer);
+}
+
+bool yacjson_lazy_array_get_decimal(YacJSONLazyValue *array, int index, double *decimal) {
+    return yacjson_lazy_value_get_decimal(yacjson_lazy_array_get(array, index), decimal);
+}
+
+bool yacjson_lazy_array_get_string(YacJSONLazyValue *array, int index, char **string) {
+    return yacjson_lazy_value_get_string(yacjson_lazy_array_get(array, index), string);
+}
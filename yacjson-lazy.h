@@ -0,0 +1,95 @@
+#ifndef YACJSON_LAZY_H
+#define YACJSON_LAZY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "mapfile.h"
+#include "yacjson-core.h"
+
+typedef struct YacJSONLazyValue YacJSONLazyValue;
+
+// Keeps the raw buffer plus a structural index of it, where every opening
+// bracket knows the index of its closing one. Containers are decoded one
+// level at a time on first access and cached in the arena; subtrees nobody
+// visits are skipped over without looking at their bytes
+typedef struct {
+    YacDocMappedFile file;
+    const char *data;
+    size_t len;
+    size_t *positions;
+    size_t *match;
+    size_t count;
+    YacDocArena *arena;
+    YacJSONLazyValue *root;
+} YacJSONLazyDocument;
+
+// Entry of a decoded object; keys are unescaped like in the tree parser and
+// are not NUL-terminated
+typedef struct {
+    const char *key;
+    size_t key_len;
+    uint64_t hash;
+    YacJSONLazyValue *value;
+} YacJSONLazyEntry;
+
+struct YacJSONLazyValue {
+    YacJSONLazyDocument *doc;
+    size_t token;
+    bool is_scalar;
+    bool is_resolved;
+    bool is_malformed;
+    YacJSONValueType type;
+    union {
+        bool boolean;
+        long integer;
+        double decimal;
+        char *string;
+    } data;
+    size_t string_len;
+    int size;
+    YacJSONLazyEntry *entries;
+    YacJSONLazyValue **items;
+    int *slots;
+    size_t slot_mask;
+};
+
+YacJSONLazyDocument *yacjson_lazy_document_parse_buffer(const char *data, size_t len);
+YacJSONLazyDocument *yacjson_lazy_document_parse_mmap(const char *filepath);
+void yacjson_lazy_document_free(YacJSONLazyDocument *doc);
+YacJSONLazyValue *yacjson_lazy_document_root(YacJSONLazyDocument *doc);
+
+YacJSONValueType yacjson_lazy_value_type(YacJSONLazyValue *value);
+YacJSONValue *yacjson_lazy_value_materialize(YacJSONLazyValue *value);
+bool yacjson_lazy_value_to_boolean(YacJSONLazyValue *value);
+long yacjson_lazy_value_to_integer(YacJSONLazyValue *value);
+double yacjson_lazy_value_to_decimal(YacJSONLazyValue *value);
+char *yacjson_lazy_value_to_string(YacJSONLazyValue *value);
+
+int yacjson_lazy_object_size(YacJSONLazyValue *object);
+int yacjson_lazy_array_size(YacJSONLazyValue *array);
+YacJSONLazyEntry *yacjson_lazy_object_entry(YacJSONLazyValue *object, int index);
+
+// Syntax below the top level is only checked as it is reached, so every
+// accessor can fail: _get and the container getters return NULL, and the
+// typed getters return false and leave their output alone, for a member that
+// is missing, malformed or of another type. Decimals may be read from
+// integers. The _to_ conversions take a value already known to be valid
+YacJSONLazyValue *yacjson_lazy_object_get(YacJSONLazyValue *object, const char *key);
+YacJSONLazyValue *yacjson_lazy_array_get(YacJSONLazyValue *array, int index);
+YacJSONLazyValue *yacjson_lazy_object_get_object(YacJSONLazyValue *object, const char *key);
+YacJSONLazyValue *yacjson_lazy_object_get_array(YacJSONLazyValue *object, const char *key);
+bool yacjson_lazy_object_get_boolean(YacJSONLazyValue *object, const char *key, bool *boolean);
+bool yacjson_lazy_object_get_integer(YacJSONLazyValue *object, const char *key, long *integer);
+bool yacjson_lazy_object_get_decimal(YacJSONLazyValue *object, const char *key, double *decimal);
+bool yacjson_lazy_object_get_string(YacJSONLazyValue *object, const char *key, char **string);
+YacJSONLazyValue *yacjson_lazy_array_get_object(YacJSONLazyValue *array, int index);
+YacJSONLazyValue *yacjson_lazy_array_get_array(YacJSONLazyValue *array, int index);
+bool yacjson_lazy_array_get_boolean(YacJSONLazyValue *array, int index, bool *boolean);
+bool yacjson_lazy_array_get_integer(YacJSONLazyValue *array, int index, long *integer);
+bool yacjson_lazy_array_get_decimal(YacJSONLazyValue *array, int index, double *decimal);
+bool yacjson_lazy_array_get_string(YacJSONLazyValue *array, int index, char **string);
+
+#endif
@@ -0,0 +1,143 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapfile.h"
+#include "threadpool.h"
+#include "yacjson-core.h"
+#include "yacjson-lines.h"
+
+// Chunks per worker, so that a worker stuck on a slow chunk does not hold the
+// whole batch back
+#define YACJSON_LINES_CHUNKS_PER_THREAD (4)
+#define YACJSON_LINES_MIN_CHUNK_LEN (64 * 1024)
+
+typedef struct {
+    size_t start;
+    size_t end;
+    YacJSONValue **values;
+    size_t count;
+    size_t capacity;
+    bool is_malformed;
+} YacJSONLinesChunk;
+
+typedef struct {
+    const char *data;
+    YacJSONLinesChunk *chunks;
+    YacJSONLinesFunc func;
+    void *ctx;
+} YacJSONLinesJob;
+
+static void yacjson_lines_chunk_add(YacJSONLinesChunk *chunk, YacJSONValue *value) {
+    if (chunk->count == chunk->capacity) {
+        chunk->capacity = chunk->capacity == 0 ? 256 : chunk->capacity * 2;
+        chunk->values = realloc(chunk->values, chunk->capacity * sizeof(YacJSONValue *));
+        assert(chunk->values != NULL);
+    }
+    chunk->values[chunk->count++] = value;
+}
+
+static bool yacjson_lines_is_blank(const char *start, const char *end) {
+    for (; start < end; start++) {
+        if (*start != ' ' && *start != '\t' && *start != '\r') return false;
+    }
+    return true;
+}
+
+static void yacjson_lines_parse_chunk(void *ctx, int index) {
+    YacJSONLinesJob *job = ctx;
+    YacJSONLinesChunk *chunk = &job->chunks[index];
+    const char *ptr = job->data + chunk->start;
+    const char *end = job->data + chunk->end;
+    while (ptr < end) {
+        const char *line_end = memchr(ptr, '\n', end - ptr);
+        if (line_end == NULL) line_end = end;
+        if (!yacjson_lines_is_blank(ptr, line_end)) {
+            YacJSONValue *value = yacjson_parse_buffer(ptr, line_end - ptr);
+            if (value == NULL) chunk->is_malformed = true;
+            if (job->func != NULL) {
+                job->func(job->ctx, ptr - job->data, value);
+            } else if (value == NULL) {
+                return;
+            } else {
+                yacjson_lines_chunk_add(chunk, value);
+            }
+        }
+        ptr = line_end + 1;
+    }
+}
+
+// Cuts the file into roughly equal chunks that each end right after a newline,
+// so that no record straddles two chunks
+static int yacjson_lines_split(const char *data, size_t len, int count, YacJSONLinesChunk *chunks) {
+    size_t chunk_len = len / count;
+    if (chunk_len < YACJSON_LINES_MIN_CHUNK_LEN) chunk_len = YACJSON_LINES_MIN_CHUNK_LEN;
+    size_t start = 0;
+    int n = 0;
+    while (start < len && n < count) {
+        size_t end = len;
+        if (n < count - 1 && len - start > chunk_len) {
+            const char *newline = memchr(data + start + chunk_len, '\n', len - start - chunk_len);
+            if (newline != NULL) end = newline - data + 1;
+        }
+        chunks[n].start = start;
+        chunks[n].end = end;
+        chunks[n].values = NULL;
+        chunks[n].count = 0;
+        chunks[n].capacity = 0;
+        chunks[n].is_malformed = false;
+        start = end;
+        n++;
+    }
+    return n;
+}
+
+static YacJSONArray *yacjson_lines_run(const char *filepath, int threads, YacJSONLinesFunc func, void *ctx, bool *is_malformed) {
+    YacDocMappedFile file;
+    yacdoc_mapped_file_open(&file, filepath);
+    YacDocThreadPool *pool = yacdoc_threadpool_new(threads);
+    int count = yacdoc_threadpool_size(pool) * YACJSON_LINES_CHUNKS_PER_THREAD;
+    YacJSONLinesChunk *chunks = malloc(count * sizeof(YacJSONLinesChunk));
+    assert(chunks != NULL);
+    count = yacjson_lines_split(file.data, file.len, count, chunks);
+    YacJSONLinesJob job = { file.data, chunks, func, ctx };
+    yacdoc_threadpool_run(pool, yacjson_lines_parse_chunk, &job, count);
+    yacdoc_threadpool_free(pool);
+    yacdoc_mapped_file_close(&file);
+    *is_malformed = false;
+    for (int i = 0; i < count; i++) *is_malformed |= chunks[i].is_malformed;
+    YacJSONArray *array = NULL;
+    if (func == NULL) {
+        if (!*is_malformed) {
+            array = yacjson_array_new();
+            size_t total = 0;
+            for (int i = 0; i < count; i++) total += chunks[i].count;
+            yacdoc_arraylist_reserve(array, (int) total);
+        }
+        // Chunks are stitched together in file order, which restores input order
+        for (int i = 0; i < count; i++) {
+            if (array != NULL) {
+                yacdoc_arraylist_add_all(array, (void *const *) chunks[i].values, (int) chunks[i].count);
+            } else {
+                for (size_t j = 0; j < chunks[i].count; j++) yacjson_value_free(chunks[i].values[j]);
+            }
+            free(chunks[i].values);
+        }
+    }
+    free(chunks);
+    return array;
+}
+
+YacJSONArray *yacjson_parse_lines(const char *filepath, int threads) {
+    bool is_malformed;
+    return yacjson_lines_run(filepath, threads, NULL, NULL, &is_malformed);
+}
+
+bool yacjson_parse_lines_each(const char *filepath, int threads, YacJSONLinesFunc func, void *ctx) {
+    bool is_malformed;
+    assert(func != NULL);
+    yacjson_lines_run(filepath, threads, func, ctx, &is_malformed);
+    return !is_malformed;
+}
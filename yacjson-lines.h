@@ -0,0 +1,23 @@
+#ifndef YACJSON_LINES_H
+#define YACJSON_LINES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "yacjson-core.h"
+
+// Receives every record of a JSON Lines file together with its byte offset in
+// the file; value is NULL when the record is malformed and is otherwise owned
+// by the callback. Calls come from several worker threads at once and in no
+// particular order, the offsets give the input order back
+typedef void (* YacJSONLinesFunc)(void *ctx, size_t offset, YacJSONValue *value);
+
+// Parses every record of a JSON Lines file into one array, in input order;
+// blank lines are skipped. All or nothing: a single malformed record, or one
+// whose root is not an object or array, makes the whole call return NULL.
+// yacjson_parse_lines_each hands out the good records and the offsets of the
+// bad ones instead, and returns false if there were any
+YacJSONArray *yacjson_parse_lines(const char *filepath, int threads);
+bool yacjson_parse_lines_each(const char *filepath, int threads, YacJSONLinesFunc func, void *ctx);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef YACJSON_NUMBER_H
+#define YACJSON_NUMBER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Longest text either formatter writes; neither adds a terminating NUL
+#define YACJSON_NUMBER_MAX_FORMAT_LEN (32)
+
+typedef enum {
+    YACJSON_NUMBER_INTEGER,
+    YACJSON_NUMBER_DECIMAL,
+    YACJSON_NUMBER_OUT_OF_RANGE,
+    YACJSON_NUMBER_INVALID,
+} YacJSONNumberType;
+
+bool yacjson_number_is_start(char c);
+YacJSONNumberType yacjson_number_parse(const char *start, size_t len, long *integer, double *decimal);
+size_t yacjson_number_format_integer(long value, char *buf);
+size_t yacjson_number_format_decimal(double value, char *buf);
+
+#endif
@@ -0,0 +1,271 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "yacjson-push.h"
+
+#define YACJSON_PUSH_INITIAL_CAPACITY (64)
+
+YacJSONPushParser *yacjson_push_parser_new(const YacJSONSaxHandler *handler, void *ctx) {
+    YacJSONPushParser *parser = malloc(sizeof(YacJSONPushParser));
+    assert(parser != NULL);
+    parser->handler = handler;
+    parser->ctx = ctx;
+    parser->state = YACJSON_PUSH_VALUE;
+    parser->is_key = false;
+    parser->is_escaped = false;
+    parser->skip_value = false;
+    parser->skip_depth = 0;
+    parser->depth = 0;
+    parser->stack_capacity = YACJSON_PUSH_INITIAL_CAPACITY;
+    parser->stack = malloc(parser->stack_capacity);
+    assert(parser->stack != NULL);
+    parser->scratch_len = 0;
+    parser->scratch_capacity = YACJSON_PUSH_INITIAL_CAPACITY;
+    parser->scratch = malloc(parser->scratch_capacity);
+    assert(parser->scratch != NULL);
+    return parser;
+}
+
+void yacjson_push_parser_free(YacJSONPushParser *parser) {
+    free(parser->stack);
+    free(parser->scratch);
+    free(parser);
+}
+
+static void yacjson_push_scratch_append(YacJSONPushParser *parser, const char *data, size_t len) {
+    if (parser->scratch_len + len > parser->scratch_capacity) {
+        while (parser->scratch_len + len > parser->scratch_capacity) parser->scratch_capacity *= 2;
+        parser->scratch = realloc(parser->scratch, parser->scratch_capacity);
+        assert(parser->scratch != NULL);
+    }
+    memcpy(parser->scratch + parser->scratch_len, data, len);
+    parser->scratch_len += len;
+}
+
+static bool yacjson_push_is_suppressed(YacJSONPushParser *parser) {
+    return parser->skip_depth > 0 || parser->skip_value;
+}
+
+static void yacjson_push_apply(YacJSONPushParser *parser, YacJSONSaxAction action) {
+    if (action == YACJSON_SAX_STOP) parser->state = YACJSON_PUSH_STOPPED;
+}
+
+static void yacjson_push_value_done(YacJSONPushParser *parser) {
+    if (parser->state == YACJSON_PUSH_STOPPED) return;
+    parser->state = parser->depth == 0 ? YACJSON_PUSH_DONE : YACJSON_PUSH_AFTER_VALUE;
+}
+
+static void yacjson_push_open(YacJSONPushParser *parser, char bracket) {
+    if (parser->depth == parser->stack_capacity) {
+        parser->stack_capacity *= 2;
+        parser->stack = realloc(parser->stack, parser->stack_capacity);
+        assert(parser->stack != NULL);
+    }
+    parser->stack[parser->depth++] = bracket;
+    if (parser->skip_depth > 0) {
+        parser->skip_depth++;
+    } else if (parser->skip_value) {
+        parser->skip_value = false;
+        parser->skip_depth = 1;
+    } else {
+        YacJSONSaxAction action = YACJSON_SAX_CONTINUE;
+        YacJSONSaxAction (* start)(void *) = bracket == '{' ? parser->handler->start_object : parser->handler->start_array;
+        if (start != NULL) action = start(parser->ctx);
+        if (action == YACJSON_SAX_SKIP) parser->skip_depth = 1;
+        yacjson_push_apply(parser, action);
+        if (parser->state == YACJSON_PUSH_STOPPED) return;
+    }
+    parser->state = bracket == '{' ? YACJSON_PUSH_OBJECT_FIRST : YACJSON_PUSH_ARRAY_FIRST;
+}
+
+static void yacjson_push_close(YacJSONPushParser *parser, char bracket) {
+    if (parser->depth == 0 || parser->stack[parser->depth - 1] != (bracket == '}' ? '{' : '[')) {
+        parser->state = YACJSON_PUSH_ERROR;
+        return;
+    }
+    parser->depth--;
+    if (parser->skip_depth > 0) {
+        parser->skip_depth--;
+    } else {
+        YacJSONSaxAction (* end)(void *) = bracket == '}' ? parser->handler->end_object : parser->handler->end_array;
+        if (end != NULL) yacjson_push_apply(parser, end(parser->ctx));
+    }
+    yacjson_push_value_done(parser);
+}
+
+static void yacjson_push_emit_string(YacJSONPushParser *parser, const char *start, size_t len) {
+    if (parser->is_key) {
+        parser->state = YACJSON_PUSH_COLON;
+        if (parser->skip_depth > 0 || parser->handler->key == NULL) return;
+        YacJSONSaxAction action = parser->handler->key(parser->ctx, start, len);
+        if (action == YACJSON_SAX_SKIP) parser->skip_value = true;
+        yacjson_push_apply(parser, action);
+        return;
+    }
+    if (yacjson_push_is_suppressed(parser)) {
+        parser->skip_value = false;
+    } else if (parser->handler->string != NULL) {
+        yacjson_push_apply(parser, parser->handler->string(parser->ctx, start, len));
+    }
+    yacjson_push_value_done(parser);
+}
+
+static void yacjson_push_emit_scalar(YacJSONPushParser *parser, const char *start, size_t len) {
+    if (yacjson_push_is_suppressed(parser)) {
+        parser->skip_value = false;
+    } else {
+        YacJSONSaxResult result = yacjson_sax_scalar(parser->handler, parser->ctx, start, len);
+        if (result == YACJSON_SAX_ERROR) {
+            parser->state = YACJSON_PUSH_ERROR;
+            return;
+        }
+        if (result == YACJSON_SAX_STOPPED) parser->state = YACJSON_PUSH_STOPPED;
+    }
+    yacjson_push_value_done(parser);
+}
+
+static const char *yacjson_push_scan_string(YacJSONPushParser *parser, const char *ptr, const char *end) {
+    while (ptr < end) {
+        if (parser->is_escaped) {
+            parser->is_escaped = false;
+        } else if (*ptr == '\\') {
+            parser->is_escaped = true;
+        } else if (*ptr == '"') {
+            return ptr;
+        }
+        ptr++;
+    }
+    return ptr;
+}
+
+static const char *yacjson_push_scan_scalar(const char *ptr, const char *end) {
+    while (ptr < end) {
+        switch (*ptr) {
+            case '"':
+            case ' ':
+            case '\n':
+            case '\r':
+            case '\t':
+            case ',':
+            case ':':
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+                return ptr;
+        }
+        ptr++;
+    }
+    return ptr;
+}
+
+bool yacjson_push_parser_feed(YacJSONPushParser *parser, const char *data, size_t len) {
+    const char *ptr = data, *end = data + len;
+    while (ptr < end) {
+        switch (parser->state) {
+            case YACJSON_PUSH_DONE:
+                return true;
+            case YACJSON_PUSH_STOPPED:
+            case YACJSON_PUSH_ERROR:
+                return false;
+            case YACJSON_PUSH_STRING:
+            case YACJSON_PUSH_SCALAR: {
+                bool is_string = parser->state == YACJSON_PUSH_STRING;
+                const char *start = ptr;
+                ptr = is_string ? yacjson_push_scan_string(parser, ptr, end) : yacjson_push_scan_scalar(ptr, end);
+                if (ptr == end) {
+                    yacjson_push_scratch_append(parser, start, ptr - start);
+                    continue;
+                }
+                if (parser->scratch_len > 0) {
+                    yacjson_push_scratch_append(parser, start, ptr - start);
+                    start = parser->scratch;
+                }
+                size_t token_len = parser->scratch_len > 0 ? parser->scratch_len : (size_t) (ptr - start);
+                if (is_string) {
+                    yacjson_push_emit_string(parser, start, token_len);
+                    ptr++;
+                } else {
+                    yacjson_push_emit_scalar(parser, start, token_len);
+                }
+                parser->scratch_len = 0;
+                continue;
+            }
+            default:
+                break;
+        }
+        char ch = *ptr;
+        if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') {
+            ptr++;
+            continue;
+        }
+        switch (parser->state) {
+            case YACJSON_PUSH_OBJECT_FIRST:
+            case YACJSON_PUSH_KEY:
+                if (ch == '}' && parser->state == YACJSON_PUSH_OBJECT_FIRST) {
+                    yacjson_push_close(parser, ch);
+                } else if (ch == '"') {
+                    parser->is_key = true;
+                    parser->state = YACJSON_PUSH_STRING;
+                } else {
+                    parser->state = YACJSON_PUSH_ERROR;
+                }
+                ptr++;
+                break;
+            case YACJSON_PUSH_COLON:
+                parser->state = ch == ':' ? YACJSON_PUSH_VALUE : YACJSON_PUSH_ERROR;
+                ptr++;
+                break;
+            case YACJSON_PUSH_AFTER_VALUE:
+                if (ch == ',') {
+                    parser->state = parser->stack[parser->depth - 1] == '{' ? YACJSON_PUSH_KEY : YACJSON_PUSH_VALUE;
+                } else if (ch == '}' || ch == ']') {
+                    yacjson_push_close(parser, ch);
+                } else {
+                    parser->state = YACJSON_PUSH_ERROR;
+                }
+                ptr++;
+                break;
+            case YACJSON_PUSH_ARRAY_FIRST:
+                if (ch == ']') {
+                    yacjson_push_close(parser, ch);
+                    ptr++;
+                    break;
+                }
+                // fall through
+            case YACJSON_PUSH_VALUE:
+                if (parser->depth == 0 && ch != '{' && ch != '[') {
+                    parser->state = YACJSON_PUSH_ERROR;
+                } else if (ch == '{' || ch == '[') {
+                    yacjson_push_open(parser, ch);
+                    ptr++;
+                } else if (ch == '"') {
+                    parser->is_key = false;
+                    parser->state = YACJSON_PUSH_STRING;
+                    ptr++;
+                } else if (ch == '}' || ch == ']' || ch == ',' || ch == ':') {
+                    parser->state = YACJSON_PUSH_ERROR;
+                } else {
+                    parser->state = YACJSON_PUSH_SCALAR;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return parser->state != YACJSON_PUSH_ERROR && parser->state != YACJSON_PUSH_STOPPED;
+}
+
+YacJSONSaxResult yacjson_push_parser_finish(YacJSONPushParser *parser) {
+    switch (parser->state) {
+        case YACJSON_PUSH_DONE:
+            return YACJSON_SAX_DONE;
+        case YACJSON_PUSH_STOPPED:
+            return YACJSON_SAX_STOPPED;
+        default:
+            return YACJSON_SAX_ERROR;
+    }
+}
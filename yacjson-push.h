@@ -0,0 +1,47 @@
+#ifndef YACJSON_PUSH_H
+#define YACJSON_PUSH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "yacjson-sax.h"
+
+typedef enum {
+    YACJSON_PUSH_VALUE,
+    YACJSON_PUSH_ARRAY_FIRST,
+    YACJSON_PUSH_OBJECT_FIRST,
+    YACJSON_PUSH_KEY,
+    YACJSON_PUSH_COLON,
+    YACJSON_PUSH_AFTER_VALUE,
+    YACJSON_PUSH_STRING,
+    YACJSON_PUSH_SCALAR,
+    YACJSON_PUSH_DONE,
+    YACJSON_PUSH_STOPPED,
+    YACJSON_PUSH_ERROR,
+} YacJSONPushState;
+
+// Resumable parser fed with arbitrary chunks; strings and scalars split across
+// chunks are collected in a growable scratch buffer, everything else is
+// reported straight from the chunk being fed
+typedef struct {
+    const YacJSONSaxHandler *handler;
+    void *ctx;
+    YacJSONPushState state;
+    bool is_key;
+    bool is_escaped;
+    bool skip_value;
+    size_t skip_depth;
+    char *stack;
+    size_t depth;
+    size_t stack_capacity;
+    char *scratch;
+    size_t scratch_len;
+    size_t scratch_capacity;
+} YacJSONPushParser;
+
+YacJSONPushParser *yacjson_push_parser_new(const YacJSONSaxHandler *handler, void *ctx);
+void yacjson_push_parser_free(YacJSONPushParser *parser);
+bool yacjson_push_parser_feed(YacJSONPushParser *parser, const char *data, size_t len);
+YacJSONSaxResult yacjson_push_parser_finish(YacJSONPushParser *parser);
+
+#endif
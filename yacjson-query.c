@@ -0,0 +1,387 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashmap.h"
+#include "mapfile.h"
+#include "yacjson-core.h"
+#include "yacjson-query.h"
+#include "yacjson-sax.h"
+
+static bool yacjson_query_parse_index(const char *start, size_t len, int *index) {
+    long value = 0;
+    if (len == 0 || (len > 1 && start[0] == '0')) return false;
+    for (size_t i = 0; i < len; i++) {
+        if (start[i] < '0' || start[i] > '9') return false;
+        value = value * 10 + (start[i] - '0');
+        if (value > INT_MAX) return false;
+    }
+    *index = (int) value;
+    return true;
+}
+
+static YacJSONQueryStep *yacjson_query_add_step(YacJSONQuery *query, YacJSONQueryStepType type) {
+    YacJSONQueryStep *step = &query->steps[query->count++];
+    step->type = type;
+    step->key = NULL;
+    step->key_len = 0;
+    step->hash = 0;
+    step->index = -1;
+    if (type == YACJSON_QUERY_WILDCARD) query->has_wildcard = true;
+    return step;
+}
+
+static void yacjson_query_add_key(YacJSONQuery *query, YacJSONQueryStepType type, const char *key, char *end) {
+    YacJSONQueryStep *step = yacjson_query_add_step(query, type);
+    *end = '\0';
+    step->key = key;
+    step->key_len = end - key;
+    step->hash = yacdoc_hashmap_hash(key);
+}
+
+static bool yacjson_query_parse_pointer(YacJSONQuery *query, const char *ptr) {
+    char *out = query->keys;
+    while (*ptr == '/') {
+        char *key = out;
+        for (ptr++; *ptr != '\0' && *ptr != '/'; ptr++) {
+            if (*ptr != '~') {
+                *out++ = *ptr;
+            } else if (ptr[1] == '0' || ptr[1] == '1') {
+                *out++ = *++ptr == '0' ? '~' : '/';
+            } else {
+                return false;
+            }
+        }
+        int index;
+        bool is_index = yacjson_query_parse_index(key, out - key, &index);
+        yacjson_query_add_key(query, is_index ? YACJSON_QUERY_KEY_OR_INDEX : YACJSON_QUERY_KEY, key, out);
+        query->steps[query->count - 1].index = is_index ? index : -1;
+        out++;
+    }
+    return *ptr == '\0';
+}
+
+static bool yacjson_query_parse_jsonpath(YacJSONQuery *query, const char *ptr) {
+    char *out = query->keys;
+    while (*ptr != '\0') {
+        char *key = out;
+        if (*ptr == '.' && ptr[1] == '*') {
+            yacjson_query_add_step(query, YACJSON_QUERY_WILDCARD);
+            ptr += 2;
+        } else if (*ptr == '.') {
+            for (ptr++; *ptr != '\0' && *ptr != '.' && *ptr != '['; ptr++) *out++ = *ptr;
+            if (out == key) return false;
+            yacjson_query_add_key(query, YACJSON_QUERY_KEY, key, out++);
+        } else if (*ptr == '[' && ptr[1] == '*' && ptr[2] == ']') {
+            yacjson_query_add_step(query, YACJSON_QUERY_WILDCARD);
+            ptr += 3;
+        } else if (*ptr == '[' && (ptr[1] == '\'' || ptr[1] == '"')) {
+            char quote = ptr[1];
+            for (ptr += 2; *ptr != '\0' && *ptr != quote; ptr++) {
+                if (*ptr == '\\' && ptr[1] != '\0') ptr++;
+                *out++ = *ptr;
+            }
+            if (*ptr != quote || ptr[1] != ']') return false;
+            yacjson_query_add_key(query, YACJSON_QUERY_KEY, key, out++);
+            ptr += 2;
+        } else if (*ptr == '[') {
+            const char *end = strchr(ptr, ']');
+            int index;
+            if (end == NULL || !yacjson_query_parse_index(ptr + 1, end - ptr - 1, &index)) return false;
+            yacjson_query_add_step(query, YACJSON_QUERY_INDEX)->index = index;
+            ptr = end + 1;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+YacJSONQuery *yacjson_query_compile(const char *path) {
+    size_t len = strlen(path);
+    YacJSONQuery *query = malloc(sizeof(YacJSONQuery));
+    assert(query != NULL);
+    // Every step takes at least one character of the path and every key fits
+    // in the characters of its step
+    query->steps = malloc((len + 1) * sizeof(YacJSONQueryStep));
+    query->keys = malloc(len + 1);
+    assert(query->steps != NULL && query->keys != NULL);
+    query->count = 0;
+    query->has_wildcard = false;
+    bool is_valid;
+    if (path[0] == '$') {
+        is_valid = yacjson_query_parse_jsonpath(query, path + 1);
+    } else {
+        is_valid = yacjson_query_parse_pointer(query, path);
+    }
+    if (!is_valid) {
+        yacjson_query_free(query);
+        return NULL;
+    }
+    return query;
+}
+
+void yacjson_query_free(YacJSONQuery *query) {
+    free(query->steps);
+    free(query->keys);
+    free(query);
+}
+
+static bool yacjson_query_step_matches_key(const YacJSONQueryStep *step, const char *key, size_t len) {
+    if (step->type == YACJSON_QUERY_WILDCARD) return true;
+    if (step->type == YACJSON_QUERY_INDEX) return false;
+    return step->key_len == len && !memcmp(step->key, key, len);
+}
+
+static bool yacjson_query_step_matches_index(const YacJSONQueryStep *step, int index) {
+    if (step->type == YACJSON_QUERY_WILDCARD) return true;
+    return step->index == index;
+}
+
+// Child selected by a step that is not a wildcard, or NULL
+static YacJSONValue *yacjson_query_child(const YacJSONQueryStep *step, YacJSONValue *value) {
+    if (yacjson_value_is_object(value)) {
+        if (step->type == YACJSON_QUERY_INDEX) return NULL;
+        return yacdoc_hashmap_get_hashed(yacjson_value_to_object(value), step->key, step->hash);
+    }
+    if (yacjson_value_is_array(value)) {
+        YacJSONArray *array = yacjson_value_to_array(value);
+        if (step->index < 0 || step->index >= yacjson_array_size(array)) return NULL;
+        return yacjson_array_get(array, step->index);
+    }
+    return NULL;
+}
+
+// Returns false once the callback asked to stop
+static bool yacjson_query_walk(YacJSONQuery *query, int depth, YacJSONValue *value, YacJSONQueryFunc func, void *ctx) {
+    if (depth == query->count) return func(ctx, value);
+    const YacJSONQueryStep *step = &query->steps[depth];
+    if (step->type != YACJSON_QUERY_WILDCARD) {
+        YacJSONValue *child = yacjson_query_child(step, value);
+        return child == NULL || yacjson_query_walk(query, depth + 1, child, func, ctx);
+    }
+    if (yacjson_value_is_object(value)) {
+        bool is_running = true;
+        YacJSONObjectItem *item;
+        YacJSONObjectIterator it;
+        yacjson_object_iterator_init(&it, yacjson_value_to_object(value));
+        while (is_running && (item = yacjson_object_iterator_next(&it)) != NULL) {
+            is_running = yacjson_query_walk(query, depth + 1, yacjson_object_item_value(item), func, ctx);
+        }
+        return is_running;
+    }
+    if (yacjson_value_is_array(value)) {
+        YacJSONArray *array = yacjson_value_to_array(value);
+        for (int i = 0; i < yacjson_array_size(array); i++) {
+            if (!yacjson_query_walk(query, depth + 1, yacjson_array_get(array, i), func, ctx)) return false;
+        }
+    }
+    return true;
+}
+
+void yacjson_query_each(YacJSONQuery *query, YacJSONValue *root, YacJSONQueryFunc func, void *ctx) {
+    yacjson_query_walk(query, 0, root, func, ctx);
+}
+
+static bool yacjson_query_keep_first(void *ctx, YacJSONValue *value) {
+    *(YacJSONValue **) ctx = value;
+    return false;
+}
+
+YacJSONValue *yacjson_query_get(YacJSONQuery *query, YacJSONValue *root) {
+    YacJSONValue *value = root;
+    if (query->has_wildcard) {
+        value = NULL;
+        yacjson_query_walk(query, 0, root, yacjson_query_keep_first, &value);
+        return value;
+    }
+    for (int i = 0; i < query->count && value != NULL; i++) value = yacjson_query_child(&query->steps[i], value);
+    return value;
+}
+
+typedef struct {
+    bool is_array;
+    int index;
+} YacJSONQueryFrame;
+
+typedef enum {
+    YACJSON_QUERY_MATCH_NONE,
+    YACJSON_QUERY_MATCH_PATH,
+    YACJSON_QUERY_MATCH_RESULT,
+} YacJSONQueryMatch;
+
+// Follows the stream along the containers that are on the path of the query
+// and skips all others over the structural index. A matching value is built
+// into a tree by forwarding its events to a tree builder, then handed out
+typedef struct {
+    YacJSONQuery *query;
+    YacJSONQueryFunc func;
+    void *ctx;
+    YacJSONQueryFrame *frames;
+    int depth;
+    const YacJSONSaxHandler *handler;
+    YacJSONTreeBuilder *builder;
+    int capture_depth;
+} YacJSONQueryStream;
+
+static YacJSONQueryMatch yacjson_query_stream_match(YacJSONQueryStream *stream) {
+    if (stream->depth > 0) {
+        YacJSONQueryFrame *frame = &stream->frames[stream->depth - 1];
+        // Object members that do not match were already skipped at their key
+        if (frame->is_array && !yacjson_query_step_matches_index(&stream->query->steps[stream->depth - 1], frame->index++)) {
+            return YACJSON_QUERY_MATCH_NONE;
+        }
+    }
+    return stream->depth == stream->query->count ? YACJSON_QUERY_MATCH_RESULT : YACJSON_QUERY_MATCH_PATH;
+}
+
+// Without wildcards a path has a single match, so the stream ends there
+static YacJSONSaxAction yacjson_query_stream_emit(YacJSONQueryStream *stream) {
+    YacJSONValue *value = yacjson_tree_builder_take(stream->builder);
+    if (!stream->func(stream->ctx, value) || !stream->query->has_wildcard) return YACJSON_SAX_STOP;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_query_stream_start(YacJSONQueryStream *stream, bool is_array) {
+    YacJSONSaxAction (* start)(void *ctx) = is_array ? stream->handler->start_array : stream->handler->start_object;
+    if (stream->capture_depth > 0) {
+        YacJSONSaxAction action = start(stream->builder);
+        if (action == YACJSON_SAX_CONTINUE) stream->capture_depth++;
+        return action;
+    }
+    switch (yacjson_query_stream_match(stream)) {
+        case YACJSON_QUERY_MATCH_NONE:
+            return YACJSON_SAX_SKIP;
+        case YACJSON_QUERY_MATCH_RESULT:
+            stream->capture_depth = 1;
+            return start(stream->builder);
+        default:
+            stream->frames[stream->depth].is_array = is_array;
+            stream->frames[stream->depth].index = 0;
+            stream->depth++;
+            return YACJSON_SAX_CONTINUE;
+    }
+}
+
+static YacJSONSaxAction yacjson_query_stream_end(YacJSONQueryStream *stream, bool is_array) {
+    if (stream->capture_depth == 0) {
+        stream->depth--;
+        return YACJSON_SAX_CONTINUE;
+    }
+    (is_array ? stream->handler->end_array : stream->handler->end_object)(stream->builder);
+    if (--stream->capture_depth > 0) return YACJSON_SAX_CONTINUE;
+    return yacjson_query_stream_emit(stream);
+}
+
+static YacJSONSaxAction yacjson_query_stream_start_object(void *ctx) {
+    return yacjson_query_stream_start(ctx, false);
+}
+
+static YacJSONSaxAction yacjson_query_stream_start_array(void *ctx) {
+    return yacjson_query_stream_start(ctx, true);
+}
+
+static YacJSONSaxAction yacjson_query_stream_end_object(void *ctx) {
+    return yacjson_query_stream_end(ctx, false);
+}
+
+static YacJSONSaxAction yacjson_query_stream_end_array(void *ctx) {
+    return yacjson_query_stream_end(ctx, true);
+}
+
+static YacJSONSaxAction yacjson_query_stream_key(void *ctx, const char *key, size_t len) {
+    YacJSONQueryStream *stream = ctx;
+    if (stream->capture_depth > 0) return stream->handler->key(stream->builder, key, len);
+    char *unescaped = yacjson_key_unescape(key, &len);
+    bool is_match = yacjson_query_step_matches_key(&stream->query->steps[stream->depth - 1], unescaped != NULL ? unescaped : key, len);
+    free(unescaped);
+    return is_match ? YACJSON_SAX_CONTINUE : YACJSON_SAX_SKIP;
+}
+
+// Scalars are forwarded while capturing, and otherwise only when they are a
+// match themselves, in which case they make up the whole value
+static bool yacjson_query_stream_wants_scalar(YacJSONQueryStream *stream) {
+    return stream->capture_depth > 0 || yacjson_query_stream_match(stream) == YACJSON_QUERY_MATCH_RESULT;
+}
+
+static YacJSONSaxAction yacjson_query_stream_scalar_done(YacJSONQueryStream *stream) {
+    return stream->capture_depth > 0 ? YACJSON_SAX_CONTINUE : yacjson_query_stream_emit(stream);
+}
+
+static YacJSONSaxAction yacjson_query_stream_null(void *ctx) {
+    YacJSONQueryStream *stream = ctx;
+    if (!yacjson_query_stream_wants_scalar(stream)) return YACJSON_SAX_CONTINUE;
+    stream->handler->null(stream->builder);
+    return yacjson_query_stream_scalar_done(stream);
+}
+
+static YacJSONSaxAction yacjson_query_stream_boolean(void *ctx, bool value) {
+    YacJSONQueryStream *stream = ctx;
+    if (!yacjson_query_stream_wants_scalar(stream)) return YACJSON_SAX_CONTINUE;
+    stream->handler->boolean(stream->builder, value);
+    return yacjson_query_stream_scalar_done(stream);
+}
+
+static YacJSONSaxAction yacjson_query_stream_integer(void *ctx, long value) {
+    YacJSONQueryStream *stream = ctx;
+    if (!yacjson_query_stream_wants_scalar(stream)) return YACJSON_SAX_CONTINUE;
+    stream->handler->integer(stream->builder, value);
+    return yacjson_query_stream_scalar_done(stream);
+}
+
+static YacJSONSaxAction yacjson_query_stream_decimal(void *ctx, double value) {
+    YacJSONQueryStream *stream = ctx;
+    if (!yacjson_query_stream_wants_scalar(stream)) return YACJSON_SAX_CONTINUE;
+    stream->handler->decimal(stream->builder, value);
+    return yacjson_query_stream_scalar_done(stream);
+}
+
+static YacJSONSaxAction yacjson_query_stream_string(void *ctx, const char *value, size_t len) {
+    YacJSONQueryStream *stream = ctx;
+    if (!yacjson_query_stream_wants_scalar(stream)) return YACJSON_SAX_CONTINUE;
+    stream->handler->string(stream->builder, value, len);
+    return yacjson_query_stream_scalar_done(stream);
+}
+
+static const YacJSONSaxHandler yacjson_query_stream_handler = {
+    .start_object = yacjson_query_stream_start_object,
+    .end_object = yacjson_query_stream_end_object,
+    .start_array = yacjson_query_stream_start_array,
+    .end_array = yacjson_query_stream_end_array,
+    .key = yacjson_query_stream_key,
+    .null = yacjson_query_stream_null,
+    .boolean = yacjson_query_stream_boolean,
+    .integer = yacjson_query_stream_integer,
+    .decimal = yacjson_query_stream_decimal,
+    .string = yacjson_query_stream_string,
+};
+
+// Returns false if the input is malformed, which may only be noticed after
+// some matches were already handed out
+bool yacjson_query_stream_buffer(YacJSONQuery *query, const char *data, size_t len, YacJSONQueryFunc func, void *ctx) {
+    YacJSONQueryStream stream;
+    stream.query = query;
+    stream.func = func;
+    stream.ctx = ctx;
+    stream.frames = malloc((query->count + 1) * sizeof(YacJSONQueryFrame));
+    assert(stream.frames != NULL);
+    stream.depth = 0;
+    stream.handler = yacjson_tree_builder_sax_handler();
+    stream.builder = yacjson_tree_builder_new();
+    stream.capture_depth = 0;
+    YacJSONSaxResult result = yacjson_sax_parse_buffer(data, len, &yacjson_query_stream_handler, &stream);
+    yacjson_tree_builder_free(stream.builder);
+    free(stream.frames);
+    return result != YACJSON_SAX_ERROR;
+}
+
+bool yacjson_query_stream_mmap(YacJSONQuery *query, const char *filepath, YacJSONQueryFunc func, void *ctx) {
+    YacDocMappedFile file;
+    yacdoc_mapped_file_open(&file, filepath);
+    bool is_valid = yacjson_query_stream_buffer(query, file.data, file.len, func, ctx);
+    yacdoc_mapped_file_close(&file);
+    return is_valid;
+}
@@ -0,0 +1,49 @@
+#ifndef YACJSON_QUERY_H
+#define YACJSON_QUERY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "yacjson-core.h"
+
+typedef enum {
+    YACJSON_QUERY_KEY,
+    YACJSON_QUERY_INDEX,
+    YACJSON_QUERY_KEY_OR_INDEX,
+    YACJSON_QUERY_WILDCARD,
+} YacJSONQueryStepType;
+
+typedef struct {
+    YacJSONQueryStepType type;
+    const char *key;
+    size_t key_len;
+    uint64_t hash;
+    int index;
+} YacJSONQueryStep;
+
+// A path compiled once into steps with their key hashes precomputed, to be run
+// against any number of documents. Accepts JSON Pointer ("", "/a/0", with ~0
+// and ~1 escapes; numeric segments match an array index or an object key) and
+// a JSONPath subset: "$" followed by .name, ['name'], [3], .* and [*]. Keys
+// are compared with the unescaped key text, as the parsers store it
+typedef struct {
+    YacJSONQueryStep *steps;
+    int count;
+    bool has_wildcard;
+    char *keys;
+} YacJSONQuery;
+
+// Receives each match in document order; returning false stops the query.
+// Values passed by the streaming functions are owned by the callback, the
+// others belong to the queried tree
+typedef bool (* YacJSONQueryFunc)(void *ctx, YacJSONValue *value);
+
+YacJSONQuery *yacjson_query_compile(const char *path);
+void yacjson_query_free(YacJSONQuery *query);
+YacJSONValue *yacjson_query_get(YacJSONQuery *query, YacJSONValue *root);
+void yacjson_query_each(YacJSONQuery *query, YacJSONValue *root, YacJSONQueryFunc func, void *ctx);
+bool yacjson_query_stream_buffer(YacJSONQuery *query, const char *data, size_t len, YacJSONQueryFunc func, void *ctx);
+bool yacjson_query_stream_mmap(YacJSONQuery *query, const char *filepath, YacJSONQueryFunc func, void *ctx);
+
+#endif
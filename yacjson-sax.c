@@ -0,0 +1,214 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "mapfile.h"
+#include "yacjson-index.h"
+#include "yacjson-number.h"
+#include "yacjson-sax.h"
+
+typedef struct {
+    YacJSONTokenizer tokenizer;
+    const YacJSONSaxHandler *handler;
+    void *ctx;
+} YacJSONSaxParser;
+
+static YacJSONSaxResult yacjson_sax_result(YacJSONSaxAction action) {
+    return action == YACJSON_SAX_STOP ? YACJSON_SAX_STOPPED : YACJSON_SAX_DONE;
+}
+
+const char *yacjson_sax_scalar_end(const char *ptr, const char *end) {
+    while (ptr < end) {
+        switch (*ptr) {
+            case ' ':
+            case '\n':
+            case '\r':
+            case '\t':
+            case ',':
+            case ':':
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+                return ptr;
+        }
+        ptr++;
+    }
+    return ptr;
+}
+
+static YacJSONSaxAction yacjson_sax_emit_string(YacJSONSaxParser *parser, const char *start, size_t len) {
+    if (parser->handler->string == NULL) return YACJSON_SAX_CONTINUE;
+    return parser->handler->string(parser->ctx, start, len);
+}
+
+// Bare tokens are null, booleans, numbers when they start like one, and
+// strings otherwise; a token that starts like a number but is not a valid JSON
+// number, or overflows a double, is an error
+YacJSONSaxResult yacjson_sax_scalar(const YacJSONSaxHandler *handler, void *ctx, const char *start, size_t len) {
+    YacJSONSaxAction action = YACJSON_SAX_CONTINUE;
+    long value_integer;
+    double value_decimal;
+    if (len == 4 && !memcmp(start, "null", 4)) {
+        if (handler->null != NULL) action = handler->null(ctx);
+    } else if ((len == 4 && !memcmp(start, "true", 4)) || (len == 5 && !memcmp(start, "false", 5))) {
+        if (handler->boolean != NULL) action = handler->boolean(ctx, len == 4);
+    } else if (len > 0 && yacjson_number_is_start(*start)) {
+        switch (yacjson_number_parse(start, len, &value_integer, &value_decimal)) {
+            case YACJSON_NUMBER_INTEGER:
+                if (handler->integer != NULL) action = handler->integer(ctx, value_integer);
+                break;
+            case YACJSON_NUMBER_DECIMAL:
+                if (handler->decimal != NULL) action = handler->decimal(ctx, value_decimal);
+                break;
+            default:
+                return YACJSON_SAX_ERROR;
+        }
+    } else if (handler->string != NULL) {
+        action = handler->string(ctx, start, len);
+    }
+    return yacjson_sax_result(action);
+}
+
+static bool yacjson_sax_read_string(YacJSONSaxParser *parser, size_t position, const char **start, size_t *len) {
+    const char *data = parser->tokenizer.data;
+    size_t close;
+    if (data[position] != '"') return false;
+    if (!yacjson_tokenizer_next(&parser->tokenizer, &close) || data[close] != '"') return false;
+    *start = data + position + 1;
+    *len = close - position - 1;
+    return true;
+}
+
+// Skips a value by matching brackets over the index; strings never contribute
+// brackets there, so no bytes inside the subtree are looked at
+static YacJSONSaxResult yacjson_sax_skip_value(YacJSONSaxParser *parser, size_t position) {
+    const char *data = parser->tokenizer.data;
+    size_t depth = 0;
+    do {
+        switch (data[position]) {
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0) return YACJSON_SAX_ERROR;
+                depth--;
+                break;
+            case '"':
+                if (!yacjson_tokenizer_next(&parser->tokenizer, &position)) return YACJSON_SAX_ERROR;
+                break;
+        }
+        if (depth == 0) return YACJSON_SAX_DONE;
+    } while (yacjson_tokenizer_next(&parser->tokenizer, &position));
+    return YACJSON_SAX_ERROR;
+}
+
+static YacJSONSaxResult yacjson_sax_parse_value(YacJSONSaxParser *parser, size_t position);
+
+static YacJSONSaxResult yacjson_sax_parse_object(YacJSONSaxParser *parser) {
+    YacJSONTokenizer *tokenizer = &parser->tokenizer;
+    const char *data = tokenizer->data;
+    YacJSONSaxResult result;
+    size_t position;
+    if (yacjson_tokenizer_peek(tokenizer, &position) && data[position] == '}') {
+        yacjson_tokenizer_next(tokenizer, &position);
+    } else {
+        while (true) {
+            const char *start;
+            size_t len;
+            if (!yacjson_tokenizer_next(tokenizer, &position)) return YACJSON_SAX_ERROR;
+            if (!yacjson_sax_read_string(parser, position, &start, &len)) return YACJSON_SAX_ERROR;
+            if (!yacjson_tokenizer_next(tokenizer, &position) || data[position] != ':') return YACJSON_SAX_ERROR;
+            if (!yacjson_tokenizer_next(tokenizer, &position)) return YACJSON_SAX_ERROR;
+            YacJSONSaxAction action = YACJSON_SAX_CONTINUE;
+            if (parser->handler->key != NULL) action = parser->handler->key(parser->ctx, start, len);
+            if (action == YACJSON_SAX_STOP) return YACJSON_SAX_STOPPED;
+            if (action == YACJSON_SAX_SKIP) {
+                result = yacjson_sax_skip_value(parser, position);
+            } else {
+                result = yacjson_sax_parse_value(parser, position);
+            }
+            if (result != YACJSON_SAX_DONE) return result;
+            if (!yacjson_tokenizer_next(tokenizer, &position)) return YACJSON_SAX_ERROR;
+            if (data[position] == ',') continue;
+            if (data[position] == '}') break;
+            return YACJSON_SAX_ERROR;
+        }
+    }
+    if (parser->handler->end_object == NULL) return YACJSON_SAX_DONE;
+    return yacjson_sax_result(parser->handler->end_object(parser->ctx));
+}
+
+static YacJSONSaxResult yacjson_sax_parse_array(YacJSONSaxParser *parser) {
+    YacJSONTokenizer *tokenizer = &parser->tokenizer;
+    const char *data = tokenizer->data;
+    YacJSONSaxResult result;
+    size_t position;
+    if (yacjson_tokenizer_peek(tokenizer, &position) && data[position] == ']') {
+        yacjson_tokenizer_next(tokenizer, &position);
+    } else {
+        while (true) {
+            if (!yacjson_tokenizer_next(tokenizer, &position)) return YACJSON_SAX_ERROR;
+            result = yacjson_sax_parse_value(parser, position);
+            if (result != YACJSON_SAX_DONE) return result;
+            if (!yacjson_tokenizer_next(tokenizer, &position)) return YACJSON_SAX_ERROR;
+            if (data[position] == ',') continue;
+            if (data[position] == ']') break;
+            return YACJSON_SAX_ERROR;
+        }
+    }
+    if (parser->handler->end_array == NULL) return YACJSON_SAX_DONE;
+    return yacjson_sax_result(parser->handler->end_array(parser->ctx));
+}
+
+static YacJSONSaxResult yacjson_sax_parse_value(YacJSONSaxParser *parser, size_t position) {
+    const YacJSONSaxHandler *handler = parser->handler;
+    const char *data = parser->tokenizer.data;
+    YacJSONSaxAction action = YACJSON_SAX_CONTINUE;
+    const char *start;
+    size_t len;
+    switch (data[position]) {
+        case '{':
+            if (handler->start_object != NULL) action = handler->start_object(parser->ctx);
+            if (action == YACJSON_SAX_SKIP) return yacjson_sax_skip_value(parser, position);
+            if (action == YACJSON_SAX_STOP) return YACJSON_SAX_STOPPED;
+            return yacjson_sax_parse_object(parser);
+        case '[':
+            if (handler->start_array != NULL) action = handler->start_array(parser->ctx);
+            if (action == YACJSON_SAX_SKIP) return yacjson_sax_skip_value(parser, position);
+            if (action == YACJSON_SAX_STOP) return YACJSON_SAX_STOPPED;
+            return yacjson_sax_parse_array(parser);
+        case '"':
+            if (!yacjson_sax_read_string(parser, position, &start, &len)) return YACJSON_SAX_ERROR;
+            return yacjson_sax_result(yacjson_sax_emit_string(parser, start, len));
+        case '}':
+        case ']':
+        case ':':
+        case ',':
+            return YACJSON_SAX_ERROR;
+    }
+    start = data + position;
+    len = yacjson_sax_scalar_end(start, data + parser->tokenizer.len) - start;
+    return yacjson_sax_scalar(parser->handler, parser->ctx, start, len);
+}
+
+YacJSONSaxResult yacjson_sax_parse_buffer(const char *data, size_t len, const YacJSONSaxHandler *handler, void *ctx) {
+    YacJSONSaxParser parser;
+    size_t position;
+    parser.handler = handler;
+    parser.ctx = ctx;
+    yacjson_tokenizer_init(&parser.tokenizer, data, len);
+    if (!yacjson_tokenizer_next(&parser.tokenizer, &position)) return YACJSON_SAX_ERROR;
+    if (data[position] != '{' && data[position] != '[') return YACJSON_SAX_ERROR;
+    return yacjson_sax_parse_value(&parser, position);
+}
+
+YacJSONSaxResult yacjson_sax_parse_mmap(const char *filepath, const YacJSONSaxHandler *handler, void *ctx) {
+    YacDocMappedFile file;
+    yacdoc_mapped_file_open(&file, filepath);
+    YacJSONSaxResult result = yacjson_sax_parse_buffer(file.data, file.len, handler, ctx);
+    yacdoc_mapped_file_close(&file);
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef YACJSON_SAX_H
+#define YACJSON_SAX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    YACJSON_SAX_CONTINUE,
+    YACJSON_SAX_SKIP,
+    YACJSON_SAX_STOP,
+} YacJSONSaxAction;
+
+typedef enum {
+    YACJSON_SAX_DONE,
+    YACJSON_SAX_STOPPED,
+    YACJSON_SAX_ERROR,
+} YacJSONSaxResult;
+
+// Any callback may be NULL. Returning YACJSON_SAX_SKIP from start_object or
+// start_array skips that container up to and including its end event, and
+// from key skips the value of that key. Strings and keys point into the input
+// without the surrounding quotes, are not NUL-terminated and are still
+// escaped; yacjson_string_unescape decodes them. null has its own event, while
+// other bare words that are neither booleans nor numbers are let through as
+// strings, since the parsers are lenient about them.
+typedef struct {
+    YacJSONSaxAction (* start_object)(void *ctx);
+    YacJSONSaxAction (* end_object)(void *ctx);
+    YacJSONSaxAction (* start_array)(void *ctx);
+    YacJSONSaxAction (* end_array)(void *ctx);
+    YacJSONSaxAction (* key)(void *ctx, const char *key, size_t len);
+    YacJSONSaxAction (* null)(void *ctx);
+    YacJSONSaxAction (* boolean)(void *ctx, bool value);
+    YacJSONSaxAction (* integer)(void *ctx, long value);
+    YacJSONSaxAction (* decimal)(void *ctx, double value);
+    YacJSONSaxAction (* string)(void *ctx, const char *value, size_t len);
+} YacJSONSaxHandler;
+
+const char *yacjson_sax_scalar_end(const char *ptr, const char *end);
+YacJSONSaxResult yacjson_sax_scalar(const YacJSONSaxHandler *handler, void *ctx, const char *start, size_t len);
+YacJSONSaxResult yacjson_sax_parse_buffer(const char *data, size_t len, const YacJSONSaxHandler *handler, void *ctx);
+YacJSONSaxResult yacjson_sax_parse_mmap(const char *filepath, const YacJSONSaxHandler *handler, void *ctx);
+
+#endif
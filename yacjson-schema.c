@@ -0,0 +1,391 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "yacjson-core.h"
+#include "yacjson-number.h"
+#include "yacjson-sax.h"
+#include "yacjson-schema.h"
+
+#define YACJSON_SCHEMA_ARRAY_INITIAL_CAPACITY (4)
+#define YACJSON_SCHEMA_ENCODE_INITIAL_CAPACITY (256)
+
+// The root of yacjson_schema_decode_array is filled like an array member of
+// this struct
+typedef struct {
+    void *items;
+    int count;
+} YacJSONSchemaRoot;
+
+// A struct being filled, with the field whose value comes next, or an array
+// being filled, with its field and the struct holding it. element describes
+// one element of that array
+typedef struct {
+    bool is_array;
+    const YacJSONSchemaType *type;
+    char *base;
+    int pending;
+    uint64_t seen;
+    const YacJSONSchemaField *field;
+    YacJSONSchemaField element;
+    int capacity;
+} YacJSONSchemaFrame;
+
+typedef struct {
+    YacJSONSchemaFrame frames[YACJSON_SCHEMA_MAX_DEPTH];
+    int depth;
+    YacJSONSchemaField root_field;
+    char *root;
+    bool is_failed;
+} YacJSONSchemaDecoder;
+
+static size_t yacjson_schema_element_size(const YacJSONSchemaField *field) {
+    switch (field->kind) {
+        case YACJSON_SCHEMA_BOOLEAN:
+            return sizeof(bool);
+        case YACJSON_SCHEMA_INTEGER:
+            return sizeof(long);
+        case YACJSON_SCHEMA_DECIMAL:
+            return sizeof(double);
+        case YACJSON_SCHEMA_STRING:
+            return sizeof(char *);
+        default:
+            return field->type->size;
+    }
+}
+
+// Room for one more zeroed element at the end of the array being filled
+static char *yacjson_schema_append(YacJSONSchemaFrame *frame) {
+    void **items = (void **) (frame->base + frame->field->offset);
+    int *count = (int *) (frame->base + frame->field->count_offset);
+    size_t size = yacjson_schema_element_size(&frame->element);
+    if (*count == frame->capacity) {
+        frame->capacity = frame->capacity > 0 ? frame->capacity * 2 : YACJSON_SCHEMA_ARRAY_INITIAL_CAPACITY;
+        *items = realloc(*items, frame->capacity * size);
+        assert(*items != NULL);
+    }
+    char *element = (char *) *items + (*count)++ * size;
+    memset(element, 0, size);
+    return element;
+}
+
+// Where the next value goes: the root, the pending member of the struct being
+// filled or a new element of the array being filled
+static char *yacjson_schema_target(YacJSONSchemaDecoder *decoder, const YacJSONSchemaField **field) {
+    if (decoder->depth == 0) {
+        *field = &decoder->root_field;
+        return decoder->root;
+    }
+    YacJSONSchemaFrame *frame = &decoder->frames[decoder->depth - 1];
+    if (frame->is_array) {
+        *field = &frame->element;
+        return yacjson_schema_append(frame);
+    }
+    *field = &frame->type->fields[frame->pending];
+    return frame->base + (*field)->offset;
+}
+
+static YacJSONSaxAction yacjson_schema_fail(YacJSONSchemaDecoder *decoder) {
+    decoder->is_failed = true;
+    return YACJSON_SAX_STOP;
+}
+
+static YacJSONSchemaFrame *yacjson_schema_push(YacJSONSchemaDecoder *decoder) {
+    if (decoder->depth == YACJSON_SCHEMA_MAX_DEPTH) return NULL;
+    YacJSONSchemaFrame *frame = &decoder->frames[decoder->depth++];
+    frame->pending = -1;
+    frame->seen = 0;
+    frame->capacity = 0;
+    return frame;
+}
+
+static YacJSONSaxAction yacjson_schema_start_object(void *ctx) {
+    YacJSONSchemaDecoder *decoder = ctx;
+    const YacJSONSchemaField *field;
+    char *ptr = yacjson_schema_target(decoder, &field);
+    if (field->kind != YACJSON_SCHEMA_STRUCT || field->is_array) return yacjson_schema_fail(decoder);
+    YacJSONSchemaFrame *frame = yacjson_schema_push(decoder);
+    if (frame == NULL) return yacjson_schema_fail(decoder);
+    frame->is_array = false;
+    frame->type = field->type;
+    frame->base = ptr;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_schema_start_array(void *ctx) {
+    YacJSONSchemaDecoder *decoder = ctx;
+    const YacJSONSchemaField *field;
+    char *ptr = yacjson_schema_target(decoder, &field);
+    if (!field->is_array) return yacjson_schema_fail(decoder);
+    YacJSONSchemaFrame *frame = yacjson_schema_push(decoder);
+    if (frame == NULL) return yacjson_schema_fail(decoder);
+    frame->is_array = true;
+    frame->base = ptr - field->offset;
+    frame->field = field;
+    frame->element = *field;
+    frame->element.is_array = false;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_schema_end(void *ctx) {
+    YacJSONSchemaDecoder *decoder = ctx;
+    decoder->depth--;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_schema_key(void *ctx, const char *key, size_t len) {
+    YacJSONSchemaDecoder *decoder = ctx;
+    YacJSONSchemaFrame *frame = &decoder->frames[decoder->depth - 1];
+    char *unescaped = yacjson_key_unescape(key, &len);
+    int index = frame->type->match(unescaped != NULL ? unescaped : key, len);
+    free(unescaped);
+    if (index < 0 || (frame->seen & (uint64_t) 1 << index)) return YACJSON_SAX_SKIP;
+    frame->seen |= (uint64_t) 1 << index;
+    frame->pending = index;
+    return YACJSON_SAX_CONTINUE;
+}
+
+// Any member may be null and is then left zeroed, as is an array element
+static YacJSONSaxAction yacjson_schema_null(void *ctx) {
+    const YacJSONSchemaField *field;
+    yacjson_schema_target(ctx, &field);
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_schema_boolean(void *ctx, bool value) {
+    YacJSONSchemaDecoder *decoder = ctx;
+    const YacJSONSchemaField *field;
+    char *ptr = yacjson_schema_target(decoder, &field);
+    if (field->kind != YACJSON_SCHEMA_BOOLEAN || field->is_array) return yacjson_schema_fail(decoder);
+    *(bool *) ptr = value;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_schema_integer(void *ctx, long value) {
+    YacJSONSchemaDecoder *decoder = ctx;
+    const YacJSONSchemaField *field;
+    char *ptr = yacjson_schema_target(decoder, &field);
+    if (field->is_array) return yacjson_schema_fail(decoder);
+    if (field->kind == YACJSON_SCHEMA_INTEGER) {
+        *(long *) ptr = value;
+    } else if (field->kind == YACJSON_SCHEMA_DECIMAL) {
+        *(double *) ptr = (double) value;
+    } else {
+        return yacjson_schema_fail(decoder);
+    }
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_schema_decimal(void *ctx, double value) {
+    YacJSONSchemaDecoder *decoder = ctx;
+    const YacJSONSchemaField *field;
+    char *ptr = yacjson_schema_target(decoder, &field);
+    if (field->kind != YACJSON_SCHEMA_DECIMAL || field->is_array) return yacjson_schema_fail(decoder);
+    *(double *) ptr = value;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static YacJSONSaxAction yacjson_schema_string(void *ctx, const char *value, size_t len) {
+    YacJSONSchemaDecoder *decoder = ctx;
+    const YacJSONSchemaField *field;
+    char *ptr = yacjson_schema_target(decoder, &field);
+    if (field->kind != YACJSON_SCHEMA_STRING || field->is_array) return yacjson_schema_fail(decoder);
+    char *string = malloc(len + 1);
+    assert(string != NULL);
+    memcpy(string, value, len);
+    string[yacjson_string_unescape(string, len)] = '\0';
+    *(char **) ptr = string;
+    return YACJSON_SAX_CONTINUE;
+}
+
+static const YacJSONSaxHandler yacjson_schema_handler = {
+    .start_object = yacjson_schema_start_object,
+    .end_object = yacjson_schema_end,
+    .start_array = yacjson_schema_start_array,
+    .end_array = yacjson_schema_end,
+    .key = yacjson_schema_key,
+    .null = yacjson_schema_null,
+    .boolean = yacjson_schema_boolean,
+    .integer = yacjson_schema_integer,
+    .decimal = yacjson_schema_decimal,
+    .string = yacjson_schema_string,
+};
+
+static bool yacjson_schema_run(YacJSONSchemaDecoder *decoder, const char *data, size_t len) {
+    decoder->depth = 0;
+    decoder->is_failed = false;
+    YacJSONSaxResult result = yacjson_sax_parse_buffer(data, len, &yacjson_schema_handler, decoder);
+    return result == YACJSON_SAX_DONE && !decoder->is_failed;
+}
+
+bool yacjson_schema_decode(const YacJSONSchemaType *type, const char *data, size_t len, void *out) {
+    YacJSONSchemaDecoder decoder;
+    memset(&decoder.root_field, 0, sizeof(YacJSONSchemaField));
+    decoder.root_field.kind = YACJSON_SCHEMA_STRUCT;
+    decoder.root_field.type = type;
+    decoder.root = out;
+    memset(out, 0, type->size);
+    if (!yacjson_schema_run(&decoder, data, len)) {
+        yacjson_schema_free(type, out);
+        memset(out, 0, type->size);
+        return false;
+    }
+    return true;
+}
+
+// Decodes a root array of the type into a new array of structs, which stays
+// NULL while empty
+bool yacjson_schema_decode_array(const YacJSONSchemaType *type, const char *data, size_t len, void **items, int *count) {
+    YacJSONSchemaDecoder decoder;
+    YacJSONSchemaRoot root = {NULL, 0};
+    memset(&decoder.root_field, 0, sizeof(YacJSONSchemaField));
+    decoder.root_field.kind = YACJSON_SCHEMA_STRUCT;
+    decoder.root_field.is_array = true;
+    decoder.root_field.offset = offsetof(YacJSONSchemaRoot, items);
+    decoder.root_field.count_offset = offsetof(YacJSONSchemaRoot, count);
+    decoder.root_field.type = type;
+    decoder.root = (char *) &root;
+    *items = NULL;
+    *count = 0;
+    if (!yacjson_schema_run(&decoder, data, len)) {
+        yacjson_schema_free_array(type, root.items, root.count);
+        return false;
+    }
+    *items = root.items;
+    *count = root.count;
+    return true;
+}
+
+static void yacjson_schema_free_element(const YacJSONSchemaField *field, char *ptr) {
+    if (field->kind == YACJSON_SCHEMA_STRING) {
+        free(*(char **) ptr);
+    } else if (field->kind == YACJSON_SCHEMA_STRUCT) {
+        yacjson_schema_free(field->type, ptr);
+    }
+}
+
+// Frees what the members own, not the struct itself
+void yacjson_schema_free(const YacJSONSchemaType *type, void *value) {
+    for (int i = 0; i < type->count; i++) {
+        const YacJSONSchemaField *field = &type->fields[i];
+        char *ptr = (char *) value + field->offset;
+        if (!field->is_array) {
+            yacjson_schema_free_element(field, ptr);
+            continue;
+        }
+        char *items = *(char **) ptr;
+        int count = *(int *) ((char *) value + field->count_offset);
+        size_t size = yacjson_schema_element_size(field);
+        for (int j = 0; j < count; j++) yacjson_schema_free_element(field, items + j * size);
+        free(items);
+    }
+}
+
+void yacjson_schema_free_array(const YacJSONSchemaType *type, void *items, int count) {
+    for (int i = 0; i < count; i++) yacjson_schema_free(type, (char *) items + i * type->size);
+    free(items);
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} YacJSONSchemaBuffer;
+
+static char *yacjson_schema_reserve(YacJSONSchemaBuffer *buffer, size_t len) {
+    if (buffer->capacity - buffer->len < len) {
+        while (buffer->capacity - buffer->len < len) buffer->capacity *= 2;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+        assert(buffer->data != NULL);
+    }
+    return buffer->data + buffer->len;
+}
+
+static void yacjson_schema_write(YacJSONSchemaBuffer *buffer, const char *data, size_t len) {
+    memcpy(yacjson_schema_reserve(buffer, len), data, len);
+    buffer->len += len;
+}
+
+static void yacjson_schema_encode_struct(YacJSONSchemaBuffer *buffer, const YacJSONSchemaType *type, const char *value);
+
+static void yacjson_schema_encode_element(YacJSONSchemaBuffer *buffer, const YacJSONSchemaField *field, const char *ptr) {
+    switch (field->kind) {
+        case YACJSON_SCHEMA_BOOLEAN:
+            if (*(const bool *) ptr) {
+                yacjson_schema_write(buffer, "true", 4);
+            } else {
+                yacjson_schema_write(buffer, "false", 5);
+            }
+            break;
+        case YACJSON_SCHEMA_INTEGER: {
+            char *out = yacjson_schema_reserve(buffer, YACJSON_NUMBER_MAX_FORMAT_LEN);
+            buffer->len += yacjson_number_format_integer(*(const long *) ptr, out);
+            break;
+        }
+        case YACJSON_SCHEMA_DECIMAL: {
+            char *out = yacjson_schema_reserve(buffer, YACJSON_NUMBER_MAX_FORMAT_LEN);
+            buffer->len += yacjson_number_format_decimal(*(const double *) ptr, out);
+            break;
+        }
+        case YACJSON_SCHEMA_STRING: {
+            const char *string = *(char * const *) ptr;
+            if (string == NULL) {
+                yacjson_schema_write(buffer, "null", 4);
+                break;
+            }
+            size_t len = strlen(string);
+            char *out = yacjson_schema_reserve(buffer, 6 * len + 2);
+            *out = '"';
+            size_t written = yacjson_string_escape(out + 1, string, len);
+            out[1 + written] = '"';
+            buffer->len += written + 2;
+            break;
+        }
+        default:
+            yacjson_schema_encode_struct(buffer, field->type, ptr);
+    }
+}
+
+static void yacjson_schema_encode_struct(YacJSONSchemaBuffer *buffer, const YacJSONSchemaType *type, const char *value) {
+    yacjson_schema_write(buffer, "{", 1);
+    for (int i = 0; i < type->count; i++) {
+        const YacJSONSchemaField *field = &type->fields[i];
+        if (i > 0) yacjson_schema_write(buffer, ",", 1);
+        char *out = yacjson_schema_reserve(buffer, field->key_len + 3);
+        *out = '"';
+        memcpy(out + 1, field->key, field->key_len);
+        memcpy(out + 1 + field->key_len, "\":", 2);
+        buffer->len += field->key_len + 3;
+        if (!field->is_array) {
+            yacjson_schema_encode_element(buffer, field, value + field->offset);
+            continue;
+        }
+        const char *items = *(char * const *) (value + field->offset);
+        int count = *(const int *) (value + field->count_offset);
+        size_t size = yacjson_schema_element_size(field);
+        yacjson_schema_write(buffer, "[", 1);
+        for (int j = 0; j < count; j++) {
+            if (j > 0) yacjson_schema_write(buffer, ",", 1);
+            yacjson_schema_encode_element(buffer, field, items + j * size);
+        }
+        yacjson_schema_write(buffer, "]", 1);
+    }
+    yacjson_schema_write(buffer, "}", 1);
+}
+
+// Compact output with the members in declaration order, NUL-terminated; NULL
+// strings are written as null
+char *yacjson_schema_encode(const YacJSONSchemaType *type, const void *value, size_t *len) {
+    YacJSONSchemaBuffer buffer;
+    buffer.capacity = YACJSON_SCHEMA_ENCODE_INITIAL_CAPACITY;
+    buffer.data = malloc(buffer.capacity);
+    assert(buffer.data != NULL);
+    buffer.len = 0;
+    yacjson_schema_encode_struct(&buffer, type, value);
+    *yacjson_schema_reserve(&buffer, 1) = '\0';
+    if (len != NULL) *len = buffer.len;
+    return buffer.data;
+}
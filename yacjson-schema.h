@@ -0,0 +1,57 @@
+#ifndef YACJSON_SCHEMA_H
+#define YACJSON_SCHEMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define YACJSON_SCHEMA_MAX_DEPTH (64)
+#define YACJSON_SCHEMA_MAX_FIELDS (64)
+
+typedef enum {
+    YACJSON_SCHEMA_BOOLEAN,
+    YACJSON_SCHEMA_INTEGER,
+    YACJSON_SCHEMA_DECIMAL,
+    YACJSON_SCHEMA_STRING,
+    YACJSON_SCHEMA_STRUCT,
+} YacJSONSchemaKind;
+
+typedef struct YacJSONSchemaType YacJSONSchemaType;
+
+// A struct member bound to a key. Arrays are a pointer to their elements at
+// offset and an int element count at count_offset
+typedef struct {
+    const char *key;
+    size_t key_len;
+    YacJSONSchemaKind kind;
+    bool is_array;
+    size_t offset;
+    size_t count_offset;
+    const YacJSONSchemaType *type;
+} YacJSONSchemaField;
+
+// Describes a C struct emitted by yacjson-gen. match returns the index of the
+// field for an unescaped key, or -1, and is generated as a switch over the key length
+// and one distinguishing character
+struct YacJSONSchemaType {
+    const char *name;
+    size_t size;
+    const YacJSONSchemaField *fields;
+    int count;
+    int (* match)(const char *key, size_t len);
+};
+
+// Decoding runs over the SAX events straight into the struct, no tree is
+// built. Unknown keys are skipped, the first of duplicate keys wins, and
+// missing members stay zero, as do members given null, strings included, which
+// are left NULL. Only a real null counts: the string "null" given to a member
+// that is not a string is of the wrong type. Strings are unescaped into
+// their own NUL-terminated allocation and arrays get one allocation each, so a
+// message made only of numbers and booleans decodes without allocating.
+// Values of the wrong type fail the decode; integers are accepted for decimals
+bool yacjson_schema_decode(const YacJSONSchemaType *type, const char *data, size_t len, void *out);
+bool yacjson_schema_decode_array(const YacJSONSchemaType *type, const char *data, size_t len, void **items, int *count);
+void yacjson_schema_free(const YacJSONSchemaType *type, void *value);
+void yacjson_schema_free_array(const YacJSONSchemaType *type, void *items, int count);
+char *yacjson_schema_encode(const YacJSONSchemaType *type, const void *value, size_t *len);
+
+#endif
@@ -0,0 +1,445 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define YACJSON_VALIDATE_X86
+#include <immintrin.h>
+#endif
+
+#include "bits.h"
+#include "yacjson-validate.h"
+
+#define YACJSON_VALIDATE_UTF8_BLOCK_LEN (64)
+
+typedef size_t (* YacJSONUtf8Func)(const char *data, size_t len);
+
+// Offset of the first byte that does not start a well-formed sequence, or len
+static size_t yacjson_utf8_validate_scalar(const char *data, size_t len) {
+    const unsigned char *ptr = (const unsigned char *) data, *end = ptr + len;
+    while (ptr < end) {
+        // Eight ASCII bytes at a time
+        if (end - ptr >= 8) {
+            uint64_t word;
+            memcpy(&word, ptr, 8);
+            if (!(word & 0x8080808080808080ULL)) {
+                ptr += 8;
+                continue;
+            }
+        }
+        unsigned char c = *ptr;
+        if (c < 0x80) {
+            ptr++;
+            continue;
+        }
+        // Continuation count, and the range the second byte must fall into
+        int count;
+        unsigned char low = 0x80, high = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            count = 1;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            count = 2;
+            if (c == 0xE0) low = 0xA0;
+            if (c == 0xED) high = 0x9F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            count = 3;
+            if (c == 0xF0) low = 0x90;
+            if (c == 0xF4) high = 0x8F;
+        } else {
+            break;
+        }
+        if (end - ptr <= count || ptr[1] < low || ptr[1] > high) break;
+        int i = 2;
+        while (i <= count && (ptr[i] & 0xC0) == 0x80) i++;
+        if (i <= count) break;
+        ptr += count + 1;
+    }
+    return (const char *) ptr - data;
+}
+
+#ifdef YACJSON_VALIDATE_X86
+
+// Lookup-table validation after Keiser and Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte": the high nibble of a byte, the low nibble
+// and the high nibble of the byte after it each select a set of error classes
+// and a pair of bytes is bad when all three agree. Third and fourth bytes of
+// a sequence are then checked against the leads two and three bytes back
+enum {
+    YACJSON_UTF8_TOO_SHORT = 1 << 0,
+    YACJSON_UTF8_TOO_LONG = 1 << 1,
+    YACJSON_UTF8_OVERLONG_3 = 1 << 2,
+    YACJSON_UTF8_TOO_LARGE = 1 << 3,
+    YACJSON_UTF8_SURROGATE = 1 << 4,
+    YACJSON_UTF8_OVERLONG_2 = 1 << 5,
+    YACJSON_UTF8_TOO_LARGE_1000 = 1 << 6,
+    YACJSON_UTF8_OVERLONG_4 = 1 << 6,
+    YACJSON_UTF8_TWO_CONTS = 1 << 7,
+    YACJSON_UTF8_CARRY = YACJSON_UTF8_TOO_SHORT | YACJSON_UTF8_TOO_LONG | YACJSON_UTF8_TWO_CONTS,
+};
+
+static const unsigned char yacjson_utf8_byte_1_high[16] = {
+    YACJSON_UTF8_TOO_LONG, YACJSON_UTF8_TOO_LONG, YACJSON_UTF8_TOO_LONG, YACJSON_UTF8_TOO_LONG,
+    YACJSON_UTF8_TOO_LONG, YACJSON_UTF8_TOO_LONG, YACJSON_UTF8_TOO_LONG, YACJSON_UTF8_TOO_LONG,
+    YACJSON_UTF8_TWO_CONTS, YACJSON_UTF8_TWO_CONTS, YACJSON_UTF8_TWO_CONTS, YACJSON_UTF8_TWO_CONTS,
+    YACJSON_UTF8_TOO_SHORT | YACJSON_UTF8_OVERLONG_2,
+    YACJSON_UTF8_TOO_SHORT,
+    YACJSON_UTF8_TOO_SHORT | YACJSON_UTF8_OVERLONG_3 | YACJSON_UTF8_SURROGATE,
+    YACJSON_UTF8_TOO_SHORT | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000 | YACJSON_UTF8_OVERLONG_4,
+};
+
+static const unsigned char yacjson_utf8_byte_1_low[16] = {
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_OVERLONG_3 | YACJSON_UTF8_OVERLONG_2 | YACJSON_UTF8_OVERLONG_4,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_OVERLONG_2,
+    YACJSON_UTF8_CARRY,
+    YACJSON_UTF8_CARRY,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000 | YACJSON_UTF8_SURROGATE,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+    YACJSON_UTF8_CARRY | YACJSON_UTF8_TOO_LARGE | YACJSON_UTF8_TOO_LARGE_1000,
+};
+
+static const unsigned char yacjson_utf8_byte_2_high[16] = {
+    YACJSON_UTF8_TOO_SHORT, YACJSON_UTF8_TOO_SHORT, YACJSON_UTF8_TOO_SHORT, YACJSON_UTF8_TOO_SHORT,
+    YACJSON_UTF8_TOO_SHORT, YACJSON_UTF8_TOO_SHORT, YACJSON_UTF8_TOO_SHORT, YACJSON_UTF8_TOO_SHORT,
+    YACJSON_UTF8_TOO_LONG | YACJSON_UTF8_OVERLONG_2 | YACJSON_UTF8_TWO_CONTS | YACJSON_UTF8_OVERLONG_3 | YACJSON_UTF8_TOO_LARGE_1000 | YACJSON_UTF8_OVERLONG_4,
+    YACJSON_UTF8_TOO_LONG | YACJSON_UTF8_OVERLONG_2 | YACJSON_UTF8_TWO_CONTS | YACJSON_UTF8_OVERLONG_3 | YACJSON_UTF8_TOO_LARGE,
+    YACJSON_UTF8_TOO_LONG | YACJSON_UTF8_OVERLONG_2 | YACJSON_UTF8_TWO_CONTS | YACJSON_UTF8_SURROGATE | YACJSON_UTF8_TOO_LARGE,
+    YACJSON_UTF8_TOO_LONG | YACJSON_UTF8_OVERLONG_2 | YACJSON_UTF8_TWO_CONTS | YACJSON_UTF8_SURROGATE | YACJSON_UTF8_TOO_LARGE,
+    YACJSON_UTF8_TOO_SHORT, YACJSON_UTF8_TOO_SHORT, YACJSON_UTF8_TOO_SHORT, YACJSON_UTF8_TOO_SHORT,
+};
+
+// The last n bytes of prev followed by input
+#define YACJSON_UTF8_PREV(input, prev, n) _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+
+__attribute__((target("avx2"))) static __m256i yacjson_utf8_high_nibbles_avx2(__m256i v) {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+// The same 16 entries in both lanes, for lookups by nibble
+__attribute__((target("avx2"))) static __m256i yacjson_utf8_table_avx2(const unsigned char *table) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) table));
+}
+
+__attribute__((target("avx2"))) static __m256i yacjson_utf8_check_avx2(__m256i input, __m256i prev_input) {
+    const __m256i byte_1_high_table = yacjson_utf8_table_avx2(yacjson_utf8_byte_1_high);
+    const __m256i byte_1_low_table = yacjson_utf8_table_avx2(yacjson_utf8_byte_1_low);
+    const __m256i byte_2_high_table = yacjson_utf8_table_avx2(yacjson_utf8_byte_2_high);
+    __m256i prev1 = YACJSON_UTF8_PREV(input, prev_input, 1);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(byte_1_high_table, yacjson_utf8_high_nibbles_avx2(prev1)),
+            _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+        _mm256_shuffle_epi8(byte_2_high_table, yacjson_utf8_high_nibbles_avx2(input)));
+    __m256i is_third = _mm256_subs_epu8(YACJSON_UTF8_PREV(input, prev_input, 2), _mm256_set1_epi8((char) (0xE0 - 0x80)));
+    __m256i is_fourth = _mm256_subs_epu8(YACJSON_UTF8_PREV(input, prev_input, 3), _mm256_set1_epi8((char) (0xF0 - 0x80)));
+    __m256i must_continue = _mm256_and_si256(_mm256_or_si256(is_third, is_fourth), _mm256_set1_epi8((char) 0x80));
+    return _mm256_xor_si256(must_continue, special);
+}
+
+// Non-zero where one of the last three bytes starts a sequence that needs
+// more bytes than are left in the block
+__attribute__((target("avx2"))) static __m256i yacjson_utf8_incomplete_avx2(__m256i input) {
+    const __m256i max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char) (0xF0 - 1), (char) (0xE0 - 1), (char) (0xC0 - 1));
+    return _mm256_subs_epu8(input, max);
+}
+
+// Checks whole blocks and hands the first bad one, or the tail, to the scalar
+// validator from the start of the sequence it begins in. Blocks of ASCII only
+// check that nothing was left open before them
+__attribute__((target("avx2"))) static size_t yacjson_utf8_validate_avx2(const char *data, size_t len) {
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    size_t offset = 0;
+    for (; offset + YACJSON_VALIDATE_UTF8_BLOCK_LEN <= len; offset += YACJSON_VALIDATE_UTF8_BLOCK_LEN) {
+        __m256i lo = _mm256_loadu_si256((const __m256i *) (data + offset));
+        __m256i hi = _mm256_loadu_si256((const __m256i *) (data + offset + 32));
+        __m256i error;
+        if (_mm256_movemask_epi8(_mm256_or_si256(lo, hi)) == 0) {
+            error = prev_incomplete;
+        } else {
+            error = _mm256_or_si256(yacjson_utf8_check_avx2(lo, prev_input), yacjson_utf8_check_avx2(hi, lo));
+            prev_incomplete = yacjson_utf8_incomplete_avx2(hi);
+            prev_input = hi;
+        }
+        if (!_mm256_testz_si256(error, error)) break;
+    }
+    size_t start = offset;
+    while (start > 0 && offset - start < 3 && ((unsigned char) data[start - 1] & 0xC0) == 0x80) start--;
+    if (start > 0 && (unsigned char) data[start - 1] >= 0xC0) start--;
+    return start + yacjson_utf8_validate_scalar(data + start, len - start);
+}
+
+#endif
+
+static YacJSONUtf8Func yacjson_select_utf8() {
+#ifdef YACJSON_VALIDATE_X86
+    if (__builtin_cpu_supports("avx2")) return yacjson_utf8_validate_avx2;
+#endif
+    return yacjson_utf8_validate_scalar;
+}
+
+typedef struct {
+    const char *data;
+    const char *end;
+    YacJSONValidateError error;
+    const char *error_at;
+} YacJSONValidator;
+
+static const char *yacjson_validate_fail(YacJSONValidator *validator, YacJSONValidateError error, const char *at) {
+    validator->error = at == validator->end ? YACJSON_VALIDATE_UNEXPECTED_END : error;
+    validator->error_at = at;
+    return NULL;
+}
+
+static const char *yacjson_validate_whitespace(const char *ptr, const char *end) {
+    while (ptr < end && (*ptr == ' ' || *ptr == '\n' || *ptr == '\r' || *ptr == '\t')) ptr++;
+    return ptr;
+}
+
+// First byte at or after ptr that ends a plain run of string contents
+static const char *yacjson_validate_string_run(const char *ptr, const char *end) {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'), control = _mm_set1_epi8(0x1F);
+    for (; end - ptr >= 16; ptr += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) ptr);
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) return ptr + yacdoc_trailing_zeros(mask);
+    }
+#endif
+    while (ptr < end && *ptr != '"' && *ptr != '\\' && (unsigned char) *ptr >= 0x20) ptr++;
+    return ptr;
+}
+
+static bool yacjson_validate_is_hex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// ptr is on the opening quote; returns what follows the closing one
+static const char *yacjson_validate_string(YacJSONValidator *validator, const char *ptr) {
+    const char *end = validator->end;
+    for (ptr++;;) {
+        ptr = yacjson_validate_string_run(ptr, end);
+        if (ptr == end) return yacjson_validate_fail(validator, YACJSON_VALIDATE_UNEXPECTED_END, ptr);
+        if (*ptr == '"') return ptr + 1;
+        if (*ptr != '\\') return yacjson_validate_fail(validator, YACJSON_VALIDATE_CONTROL_CHARACTER, ptr);
+        if (end - ptr < 2) return yacjson_validate_fail(validator, YACJSON_VALIDATE_UNEXPECTED_END, end);
+        switch (ptr[1]) {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                ptr += 2;
+                break;
+            case 'u':
+                for (int i = 2; i < 6; i++) {
+                    if (ptr + i == end) return yacjson_validate_fail(validator, YACJSON_VALIDATE_UNEXPECTED_END, end);
+                    if (!yacjson_validate_is_hex(ptr[i])) return yacjson_validate_fail(validator, YACJSON_VALIDATE_INVALID_ESCAPE, ptr);
+                }
+                ptr += 6;
+                break;
+            default:
+                return yacjson_validate_fail(validator, YACJSON_VALIDATE_INVALID_ESCAPE, ptr);
+        }
+    }
+}
+
+static const char *yacjson_validate_digits(const char *ptr, const char *end) {
+    while (ptr < end && *ptr >= '0' && *ptr <= '9') ptr++;
+    return ptr;
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+static const char *yacjson_validate_number(YacJSONValidator *validator, const char *ptr) {
+    const char *start = ptr, *end = validator->end, *digits;
+    if (*ptr == '-') ptr++;
+    if (ptr < end && *ptr == '0') {
+        ptr++;
+        if (ptr < end && *ptr >= '0' && *ptr <= '9') return yacjson_validate_fail(validator, YACJSON_VALIDATE_INVALID_NUMBER, start);
+    } else {
+        digits = ptr;
+        ptr = yacjson_validate_digits(ptr, end);
+        if (ptr == digits) return yacjson_validate_fail(validator, YACJSON_VALIDATE_INVALID_NUMBER, start);
+    }
+    if (ptr < end && *ptr == '.') {
+        digits = ++ptr;
+        ptr = yacjson_validate_digits(ptr, end);
+        if (ptr == digits) return yacjson_validate_fail(validator, YACJSON_VALIDATE_INVALID_NUMBER, start);
+    }
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+        ptr++;
+        if (ptr < end && (*ptr == '+' || *ptr == '-')) ptr++;
+        digits = ptr;
+        ptr = yacjson_validate_digits(ptr, end);
+        if (ptr == digits) return yacjson_validate_fail(validator, YACJSON_VALIDATE_INVALID_NUMBER, start);
+    }
+    return ptr;
+}
+
+static const char *yacjson_validate_literal(YacJSONValidator *validator, const char *ptr, const char *literal, size_t len) {
+    if ((size_t) (validator->end - ptr) < len || memcmp(ptr, literal, len)) {
+        return yacjson_validate_fail(validator, YACJSON_VALIDATE_INVALID_LITERAL, ptr);
+    }
+    return ptr + len;
+}
+
+static const char *yacjson_validate_scalar(YacJSONValidator *validator, const char *ptr) {
+    switch (*ptr) {
+        case '"':
+            return yacjson_validate_string(validator, ptr);
+        case 't':
+            return yacjson_validate_literal(validator, ptr, "true", 4);
+        case 'f':
+            return yacjson_validate_literal(validator, ptr, "false", 5);
+        case 'n':
+            return yacjson_validate_literal(validator, ptr, "null", 4);
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            return yacjson_validate_number(validator, ptr);
+        default:
+            return yacjson_validate_fail(validator, YACJSON_VALIDATE_UNEXPECTED_CHARACTER, ptr);
+    }
+}
+
+// A key, its colon and the whitespace around them
+static const char *yacjson_validate_key(YacJSONValidator *validator, const char *ptr) {
+    if (ptr == validator->end || *ptr != '"') return yacjson_validate_fail(validator, YACJSON_VALIDATE_UNEXPECTED_CHARACTER, ptr);
+    ptr = yacjson_validate_string(validator, ptr);
+    if (ptr == NULL) return NULL;
+    ptr = yacjson_validate_whitespace(ptr, validator->end);
+    if (ptr == validator->end || *ptr != ':') return yacjson_validate_fail(validator, YACJSON_VALIDATE_UNEXPECTED_CHARACTER, ptr);
+    return yacjson_validate_whitespace(ptr + 1, validator->end);
+}
+
+// Iterative, with the open containers kept as one bit each (set for objects)
+static void yacjson_validate_grammar(YacJSONValidator *validator) {
+    uint64_t stack[YACJSON_VALIDATE_MAX_DEPTH / 64];
+    int depth = 0;
+    const char *end = validator->end;
+    const char *ptr = yacjson_validate_whitespace(validator->data, end);
+    if (ptr == end || (*ptr != '{' && *ptr != '[')) {
+        yacjson_validate_fail(validator, YACJSON_VALIDATE_UNEXPECTED_CHARACTER, ptr);
+        return;
+    }
+    for (;;) {
+        // A value, opening as many containers as start here
+        ptr = yacjson_validate_whitespace(ptr, end);
+        if (ptr == end) {
+            yacjson_validate_fail(validator, YACJSON_VALIDATE_UNEXPECTED_END, ptr);
+            return;
+        }
+        if (*ptr == '{' || *ptr == '[') {
+            bool is_object = *ptr == '{';
+            if (depth == YACJSON_VALIDATE_MAX_DEPTH) {
+                yacjson_validate_fail(validator, YACJSON_VALIDATE_TOO_DEEP, ptr);
+                return;
+            }
+            if (is_object) {
+                stack[depth / 64] |= (uint64_t) 1 << depth % 64;
+            } else {
+                stack[depth / 64] &= ~((uint64_t) 1 << depth % 64);
+            }
+            depth++;
+            ptr = yacjson_validate_whitespace(ptr + 1, end);
+            if (ptr == end || *ptr != (is_object ? '}' : ']')) {
+                if (is_object && (ptr = yacjson_validate_key(validator, ptr)) == NULL) return;
+                continue;
+            }
+            depth--;
+            ptr++;
+        } else if ((ptr = yacjson_validate_scalar(validator, ptr)) == NULL) {
+            return;
+        }
+        // What follows a value, closing as many containers as end here
+        for (;;) {
+            ptr = yacjson_validate_whitespace(ptr, end);
+            if (depth == 0) {
+                if (ptr != end) yacjson_validate_fail(validator, YACJSON_VALIDATE_TRAILING_CONTENT, ptr);
+                return;
+            }
+            bool is_object = stack[(depth - 1) / 64] >> (depth - 1) % 64 & 1;
+            if (ptr < end && *ptr == ',') {
+                ptr = yacjson_validate_whitespace(ptr + 1, end);
+                if (is_object && (ptr = yacjson_validate_key(validator, ptr)) == NULL) return;
+                break;
+            }
+            if (ptr == end || *ptr != (is_object ? '}' : ']')) {
+                yacjson_validate_fail(validator, YACJSON_VALIDATE_UNEXPECTED_CHARACTER, ptr);
+                return;
+            }
+            depth--;
+            ptr++;
+        }
+    }
+}
+
+// Grammar and encoding are checked in two passes and the earlier of their
+// errors is reported; the grammar lets bytes past 0x7F through in strings only
+YacJSONValidateError yacjson_validate(const char *data, size_t len, size_t *offset) {
+    YacJSONValidator validator;
+    validator.data = data;
+    validator.end = data + len;
+    validator.error = YACJSON_VALIDATE_OK;
+    validator.error_at = validator.end;
+    yacjson_validate_grammar(&validator);
+    size_t utf8_error = yacjson_select_utf8()(data, len);
+    if (utf8_error < (size_t) (validator.error_at - data)) {
+        validator.error = YACJSON_VALIDATE_INVALID_UTF8;
+        validator.error_at = data + utf8_error;
+    }
+    if (offset != NULL) *offset = validator.error_at - data;
+    return validator.error;
+}
+
+const char *yacjson_validate_error_string(YacJSONValidateError error) {
+    switch (error) {
+        case YACJSON_VALIDATE_OK:
+            return "valid";
+        case YACJSON_VALIDATE_UNEXPECTED_END:
+            return "unexpected end of input";
+        case YACJSON_VALIDATE_UNEXPECTED_CHARACTER:
+            return "unexpected character";
+        case YACJSON_VALIDATE_INVALID_LITERAL:
+            return "invalid literal";
+        case YACJSON_VALIDATE_INVALID_NUMBER:
+            return "invalid number";
+        case YACJSON_VALIDATE_INVALID_ESCAPE:
+            return "invalid escape sequence";
+        case YACJSON_VALIDATE_CONTROL_CHARACTER:
+            return "unescaped control character in string";
+        case YACJSON_VALIDATE_INVALID_UTF8:
+            return "invalid UTF-8";
+        case YACJSON_VALIDATE_TOO_DEEP:
+            return "nesting too deep";
+        case YACJSON_VALIDATE_TRAILING_CONTENT:
+            return "content after the top-level value";
+        default:
+            return "unknown error";
+    }
+}
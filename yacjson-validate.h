@@ -0,0 +1,30 @@
+#ifndef YACJSON_VALIDATE_H
+#define YACJSON_VALIDATE_H
+
+#include <stddef.h>
+
+#define YACJSON_VALIDATE_MAX_DEPTH (1024)
+
+typedef enum {
+    YACJSON_VALIDATE_OK,
+    YACJSON_VALIDATE_UNEXPECTED_END,
+    YACJSON_VALIDATE_UNEXPECTED_CHARACTER,
+    YACJSON_VALIDATE_INVALID_LITERAL,
+    YACJSON_VALIDATE_INVALID_NUMBER,
+    YACJSON_VALIDATE_INVALID_ESCAPE,
+    YACJSON_VALIDATE_CONTROL_CHARACTER,
+    YACJSON_VALIDATE_INVALID_UTF8,
+    YACJSON_VALIDATE_TOO_DEEP,
+    YACJSON_VALIDATE_TRAILING_CONTENT,
+} YacJSONValidateError;
+
+// Strict RFC 8259 check that allocates nothing and builds nothing, unlike the
+// parsers, which are lenient: no bare words, no control characters in
+// strings, only the standard escapes, well-formed UTF-8 (no overlongs,
+// surrogates or code points past U+10FFFF) and no trailing content. Like the
+// parsers, it wants an object or an array at the top level. offset, which may
+// be NULL, receives the position of the first offending byte, or len
+YacJSONValidateError yacjson_validate(const char *data, size_t len, size_t *offset);
+const char *yacjson_validate_error_string(YacJSONValidateError error);
+
+#endif
@@ -7,22 +7,22 @@
 
 #include "yacxml-core.h"
 
-#define YACXML_MAX_BUFFER_LEN (256)
+#define YACXML_SCRATCH_INITIAL_CAPACITY (256)
 
-static YacXMLAttributeMap *yacxml_attribute_map_new() {
-    return yacdoc_hashmap_new();
+static YacXMLAttributeMap *yacxml_attribute_map_new(const YacDocAllocator *allocator) {
+    return yacdoc_hashmap_new_with(allocator);
 }
 
-static YacXMLChildMap *yacxml_child_map_new() {
-    return yacdoc_hashmap_new();
+static YacXMLChildMap *yacxml_child_map_new(const YacDocAllocator *allocator) {
+    return yacdoc_hashmap_new_with(allocator);
 }
 
 static void yacxml_attribute_map_add(YacXMLAttributeMap *attrs, const char *key, char *value) {
     yacdoc_hashmap_add(attrs, key, (void *) value);
 }
 
-static void yacxml_child_map_add(YacXMLChildMap *chs, const char *key, YacXMLElement *value) {
-    yacdoc_hashmap_add(chs, key, (void *) value);
+static bool yacxml_child_map_add(YacXMLChildMap *chs, const char *key, YacXMLElement *value) {
+    return yacdoc_hashmap_add(chs, key, (void *) value);
 }
 
 static char *yacxml_attribute_map_get(YacXMLAttributeMap *attrs, const char *key) {
@@ -33,12 +33,12 @@ static YacXMLElement *yacxml_child_map_get(YacXMLChildMap *chs, const char *key)
     return yacdoc_hashmap_get(chs, key);
 }
 
-YacXMLAttributeMapIterator *yacxml_attribute_map_iterator_new(YacXMLAttributeMap *attrs) {
-    return yacdoc_hashmap_iterator_new(attrs);
+void yacxml_attribute_map_iterator_init(YacXMLAttributeMapIterator *it, YacXMLAttributeMap *attrs) {
+    yacdoc_hashmap_iterator_init(it, attrs);
 }
 
-YacXMLChildMapIterator *yacxml_child_map_iterator_new(YacXMLChildMap *chs) {
-    return yacdoc_hashmap_iterator_new(chs);
+void yacxml_child_map_iterator_init(YacXMLChildMapIterator *it, YacXMLChildMap *chs) {
+    yacdoc_hashmap_iterator_init(it, chs);
 }
 
 YacXMLAttributeMapItem *yacxml_attribute_map_iterator_next(YacXMLAttributeMapIterator *it) {
@@ -49,30 +49,44 @@ YacXMLChildMapItem *yacxml_child_map_iterator_next(YacXMLChildMapIterator *it) {
     return yacdoc_hashmap_iterator_next(it);
 }
 
+static char *yacxml_strdup(const YacDocAllocator *allocator, const char *str) {
+    char *copy = yacdoc_alloc(allocator, strlen(str) + 1);
+    strcpy(copy, str);
+    return copy;
+}
+
+// An element and all it holds come from the allocator of its maps
+static const YacDocAllocator *yacxml_element_allocator(YacXMLElement *elem) {
+    return elem->attributes->allocator;
+}
+
 YacXMLElement *yacxml_element_new() {
-    YacXMLElement *elem = malloc(sizeof(YacXMLElement));
-    assert(elem != NULL);
-    elem->name = malloc(1);
-    assert(elem->name != NULL);
-    strcpy(elem->name, "");
-    elem->text = malloc(1);
-    assert(elem->text != NULL);
-    strcpy(elem->text, "");
-    elem->attributes = yacxml_attribute_map_new();
-    elem->children = yacxml_child_map_new();
+    return yacxml_element_new_with(NULL);
+}
+
+YacXMLElement *yacxml_element_new_with(const YacDocAllocator *allocator) {
+    YacXMLElement *elem = yacdoc_alloc(allocator, sizeof(YacXMLElement));
+    elem->name = yacxml_strdup(allocator, "");
+    elem->text = yacxml_strdup(allocator, "");
+    elem->attributes = yacxml_attribute_map_new(allocator);
+    elem->children = yacxml_child_map_new(allocator);
     return elem;
 }
 
-static void yacxml_element_free_void(void *elem) {
-    free(((YacXMLElement *) elem)->name);
-    free(((YacXMLElement *) elem)->text);
-    yacdoc_hashmap_free(((YacXMLElement *) elem)->attributes, free);
+static void yacxml_attribute_free_void(void *value, const YacDocAllocator *allocator) {
+    yacdoc_free(allocator, value);
+}
+
+static void yacxml_element_free_void(void *elem, const YacDocAllocator *allocator) {
+    yacdoc_free(allocator, ((YacXMLElement *) elem)->name);
+    yacdoc_free(allocator, ((YacXMLElement *) elem)->text);
+    yacdoc_hashmap_free(((YacXMLElement *) elem)->attributes, yacxml_attribute_free_void);
     yacdoc_hashmap_free(((YacXMLElement *) elem)->children, yacxml_element_free_void);
-    free(elem);
+    yacdoc_free(allocator, elem);
 }
 
 void yacxml_element_free(YacXMLElement *elem) {
-    yacxml_element_free_void((void *) elem);
+    yacxml_element_free_void((void *) elem, yacxml_element_allocator(elem));
 }
 
 char *yacxml_element_get_name(YacXMLElement *elem) {
@@ -80,10 +94,8 @@ char *yacxml_element_get_name(YacXMLElement *elem) {
 }
 
 void yacxml_element_set_name(YacXMLElement *elem, const char *name) {
-    free(elem->name);
-    elem->name = malloc(strlen(name) + 1);
-    assert(elem->name != NULL);
-    strcpy(elem->name, name);
+    yacdoc_free(yacxml_element_allocator(elem), elem->name);
+    elem->name = yacxml_strdup(yacxml_element_allocator(elem), name);
 }
 
 char *yacxml_element_get_text(YacXMLElement *elem) {
@@ -91,10 +103,8 @@ char *yacxml_element_get_text(YacXMLElement *elem) {
 }
 
 void yacxml_element_set_text(YacXMLElement *elem, const char *text) {
-    free(elem->text);
-    elem->text = malloc(strlen(text) + 1);
-    assert(elem->text != NULL);
-    strcpy(elem->text, text);
+    yacdoc_free(yacxml_element_allocator(elem), elem->text);
+    elem->text = yacxml_strdup(yacxml_element_allocator(elem), text);
 }
 
 char *yacxml_element_get_attribute(YacXMLElement *elem, const char *key) {
@@ -113,35 +123,61 @@ void yacxml_element_add_child(YacXMLElement *elem, const char *key, YacXMLElemen
     yacxml_child_map_add(elem->children, key, value);
 }
 
-static char *yacxml_get_opening_tag_name(FILE *file) {
-    char *name = NULL;
-    int ch, pos = 0;
-    static char buffer[YACXML_MAX_BUFFER_LEN];
-    while ((ch = fgetc(file)) != EOF) {
+struct YacXMLParser {
+    FILE *file;
+    const YacDocAllocator *allocator;
+    char *scratch;
+    size_t len;
+    size_t capacity;
+};
+
+// The scratch space is used as a stack: each step of the parse appends what
+// it reads after what the steps around it still hold and drops it when done,
+// so the text of an element survives the parse of its children
+static void yacxml_parser_push(YacXMLParser *parser, char ch) {
+    if (parser->len == parser->capacity) {
+        parser->capacity = parser->capacity == 0 ? YACXML_SCRATCH_INITIAL_CAPACITY : parser->capacity * 2;
+        parser->scratch = realloc(parser->scratch, parser->capacity);
+        assert(parser->scratch != NULL);
+    }
+    parser->scratch[parser->len++] = ch;
+}
+
+// Copies what was pushed since start into a string and drops it
+static char *yacxml_parser_pop_string(YacXMLParser *parser, size_t start) {
+    size_t len = parser->len - start;
+    char *str = yacdoc_alloc(parser->allocator, len + 1);
+    memcpy(str, parser->scratch + start, len);
+    str[len] = '\0';
+    parser->len = start;
+    return str;
+}
+
+static char *yacxml_get_opening_tag_name(YacXMLParser *parser) {
+    int ch;
+    size_t start = parser->len;
+    while ((ch = fgetc(parser->file)) != EOF) {
         switch (ch) {
             case '/':
             case '>':
-                ungetc(ch, file);
+                ungetc(ch, parser->file);
             case ' ':
-                buffer[pos] = '\0';
-                name = malloc(strlen(buffer) + 1);
-                assert(name != NULL);
-                strcpy(name, buffer);
-                return name;
+                return yacxml_parser_pop_string(parser, start);
         }
-        buffer[pos++] = (char) ch;
+        yacxml_parser_push(parser, (char) ch);
     }
+    parser->len = start;
     return NULL;
 }
 
-static YacXMLAttributeMap *yacxml_get_tag_attributes(FILE *file) {
-    YacXMLAttributeMap *attrs = yacxml_attribute_map_new();
-    int ch, pos = 0;
-    static char buffer[YACXML_MAX_BUFFER_LEN];
-    char key[YACXML_MAX_BUFFER_LEN];
+// The key is kept NUL-terminated at start while its value is read after it
+static YacXMLAttributeMap *yacxml_get_tag_attributes(YacXMLParser *parser) {
+    YacXMLAttributeMap *attrs = yacxml_attribute_map_new(parser->allocator);
+    int ch;
+    size_t start = parser->len, value_start = start;
     char *value;
     bool is_quoted = false;
-    while ((ch = fgetc(file)) != EOF) {
+    while ((ch = fgetc(parser->file)) != EOF) {
         if (!is_quoted) {
             switch (ch) {
                 case ' ':
@@ -150,12 +186,12 @@ static YacXMLAttributeMap *yacxml_get_tag_attributes(FILE *file) {
                     continue;
                 case '/':
                 case '>':
-                    ungetc(ch, file);
+                    ungetc(ch, parser->file);
+                    parser->len = start;
                     return attrs;
                 case '=':
-                    buffer[pos] = '\0';
-                    pos = 0;
-                    strcpy(key, buffer);
+                    yacxml_parser_push(parser, '\0');
+                    value_start = parser->len;
                     continue;
                 case '"':
                     is_quoted = true;
@@ -164,18 +200,21 @@ static YacXMLAttributeMap *yacxml_get_tag_attributes(FILE *file) {
         } else {
             switch (ch) {
                 case '"':
-                    buffer[pos] = '\0';
-                    pos = 0;
-                    value = malloc(strlen(buffer) + 1);
-                    assert(value != NULL);
-                    strcpy(value, buffer);
-                    yacxml_attribute_map_add(attrs, key, value);
+                    value = yacxml_parser_pop_string(parser, value_start);
+                    if (value_start > start) {
+                        yacxml_attribute_map_add(attrs, parser->scratch + start, value);
+                    } else {
+                        yacdoc_free(parser->allocator, value);
+                    }
+                    parser->len = start;
+                    value_start = start;
                     is_quoted = false;
                     continue;
             }
         }
-        buffer[pos++] = (char) ch;
+        yacxml_parser_push(parser, (char) ch);
     }
+    parser->len = start;
     return NULL;
 }
 
@@ -185,51 +224,50 @@ static int fpeekc(FILE *file) {
     return ch;
 }
 
-static bool fpeeks_match(FILE *file, char *target) {
-    static char buffer[YACXML_MAX_BUFFER_LEN];
+static bool fpeeks_match(YacXMLParser *parser, char *target) {
+    size_t start = parser->len;
     bool res = true;
     for (int i = 0; target[i] != '\0'; i++) {
-        buffer[i] = (char) fgetc(file);
-        if (buffer[i] != target[i]) res = false;
-    }
-    for (int j = strlen(target) - 1; j >= 0; j--) {
-        ungetc(buffer[j], file);
+        yacxml_parser_push(parser, (char) fgetc(parser->file));
+        if (parser->scratch[start + i] != target[i]) res = false;
     }
+    while (parser->len > start) ungetc(parser->scratch[--parser->len], parser->file);
     return res;
 }
 
-static bool yacxml_match_closing_tag_name(FILE *file, char *tag_name) {
-    int ch, pos = 0;
-    static char buffer[YACXML_MAX_BUFFER_LEN];
-    while ((ch = fgetc(file)) != EOF) {
+static bool yacxml_match_closing_tag_name(YacXMLParser *parser, char *tag_name) {
+    int ch;
+    size_t start = parser->len;
+    while ((ch = fgetc(parser->file)) != EOF) {
         switch (ch) {
             case ' ':
             case '/':
                 continue;
             case '>':
-                buffer[pos] = '\0';
-                return !strcmp(tag_name, buffer);
+                yacxml_parser_push(parser, '\0');
+                parser->len = start;
+                return !strcmp(tag_name, parser->scratch + start);
         }
-        buffer[pos++] = (char) ch;
+        yacxml_parser_push(parser, (char) ch);
     }
+    parser->len = start;
     return false;
 }
 
-static YacXMLElement *yacxml_parse_from_file(FILE *file) {
-    YacXMLElement *elem = malloc(sizeof(YacXMLElement));
-    assert(elem != NULL);
-    elem->name = yacxml_get_opening_tag_name(file);
-    elem->attributes = yacxml_get_tag_attributes(file);
-    elem->children = yacxml_child_map_new();
-    int ch, pos = 0;
-    static char buffer[YACXML_MAX_BUFFER_LEN];
+static YacXMLElement *yacxml_parse_from_file(YacXMLParser *parser) {
+    YacXMLElement *elem = yacdoc_alloc(parser->allocator, sizeof(YacXMLElement));
+    elem->name = yacxml_get_opening_tag_name(parser);
+    elem->attributes = yacxml_get_tag_attributes(parser);
+    elem->children = yacxml_child_map_new(parser->allocator);
+    int ch;
+    size_t start = parser->len;
     bool is_commented = false;
-    while ((ch = fgetc(file)) != EOF) {
-        if (ch == '<' && fpeeks_match(file, "!--")) {
+    while ((ch = fgetc(parser->file)) != EOF) {
+        if (ch == '<' && fpeeks_match(parser, "!--")) {
             is_commented = true;
             continue;
         }
-        if (ch == '-' && fpeeks_match(file, "->")) {
+        if (ch == '-' && fpeeks_match(parser, "->")) {
             is_commented = false;
             continue;
         }
@@ -242,34 +280,75 @@ static YacXMLElement *yacxml_parse_from_file(FILE *file) {
             case '>':
                 continue;
             case '/':
-                if (fpeekc(file) == '>') return elem;
+                if (fpeekc(parser->file) == '>') {
+                    elem->text = yacxml_parser_pop_string(parser, start);
+                    return elem;
+                }
             case '<':
-                if (fpeekc(file) == '/') {
-                    buffer[pos] = '\0';
-                    elem->text = malloc(strlen(buffer) + 1);
-                    assert(elem->text != NULL);
-                    strcpy(elem->text, buffer);
-                    assert(yacxml_match_closing_tag_name(file, elem->name));
+                if (fpeekc(parser->file) == '/') {
+                    elem->text = yacxml_parser_pop_string(parser, start);
+                    bool is_matched = yacxml_match_closing_tag_name(parser, elem->name);
+                    assert(is_matched);
+                    (void) is_matched;
                     return elem;
                 }
-                if (isalpha(fpeekc(file))) {
-                    YacXMLElement *child = yacxml_parse_from_file(file);
-                    yacxml_child_map_add(elem->children, child->name, child);
+                if (isalpha(fpeekc(parser->file))) {
+                    // Like with JSON keys, the first of children of the same
+                    // name wins and the others are dropped
+                    YacXMLElement *child = yacxml_parse_from_file(parser);
+                    if (!yacxml_child_map_add(elem->children, child->name, child)) yacxml_element_free(child);
                     continue;
                 }
                 continue;
         }
-        buffer[pos++] = (char) ch;
+        yacxml_parser_push(parser, (char) ch);
     }
+    parser->len = start;
     return NULL;
 }
 
-YacXMLElement *yacxml_parse(const char *filepath) {
-    FILE *file = fopen(filepath, "r");
+YacXMLParser *yacxml_parser_new() {
+    return yacxml_parser_new_with(NULL);
+}
+
+YacXMLParser *yacxml_parser_new_with(const YacDocAllocator *allocator) {
+    YacXMLParser *parser = malloc(sizeof(YacXMLParser));
+    assert(parser != NULL);
+    parser->file = NULL;
+    parser->allocator = allocator;
+    parser->scratch = NULL;
+    parser->len = 0;
+    parser->capacity = 0;
+    return parser;
+}
+
+void yacxml_parser_free(YacXMLParser *parser) {
+    free(parser->scratch);
+    free(parser);
+}
+
+YacXMLElement *yacxml_parser_parse(YacXMLParser *parser, const char *filepath) {
+    parser->file = fopen(filepath, "r");
+    if (parser->file == NULL) return NULL;
     // TODO: Handle XML prolog
-    assert(fgetc(file) == '<');
-    YacXMLElement *elem = yacxml_parse_from_file(file);
-    fclose(file);
+    int ch = fgetc(parser->file);
+    assert(ch == '<');
+    (void) ch;
+    YacXMLElement *elem = yacxml_parse_from_file(parser);
+    fclose(parser->file);
+    parser->file = NULL;
+    parser->len = 0;
+    return elem;
+}
+
+YacXMLElement *yacxml_parse(const char *filepath) {
+    return yacxml_parse_with(filepath, NULL);
+}
+
+YacXMLElement *yacxml_parse_with(const char *filepath, const YacDocAllocator *allocator) {
+    YacXMLParser parser = {NULL, allocator, NULL, 0, 0};
+    YacXMLElement *elem = yacxml_parser_parse(&parser, filepath);
+    free(parser.scratch);
     return elem;
 }
 
@@ -278,8 +357,9 @@ static void yacxml_serialize_to_file(YacXMLElement *elem, FILE *file, int depth)
     fputc('<', file);
     fputs(elem->name, file);
     YacXMLAttributeMapItem *attr_item;
-    YacXMLAttributeMapIterator *attr_it = yacxml_attribute_map_iterator_new(elem->attributes);
-    while ((attr_item = yacxml_attribute_map_iterator_next(attr_it)) != NULL) {
+    YacXMLAttributeMapIterator attr_it;
+    yacxml_attribute_map_iterator_init(&attr_it, elem->attributes);
+    while ((attr_item = yacxml_attribute_map_iterator_next(&attr_it)) != NULL) {
         fputc(' ', file);
         fputs(attr_item->key, file);
         fputs("=\"", file);
@@ -297,8 +377,9 @@ static void yacxml_serialize_to_file(YacXMLElement *elem, FILE *file, int depth)
         fputc('\n', file);
     }
     YacXMLChildMapItem *ch_item;
-    YacXMLChildMapIterator *ch_it = yacxml_child_map_iterator_new(elem->children);
-    while ((ch_item = yacxml_child_map_iterator_next(ch_it)) != NULL) {
+    YacXMLChildMapIterator ch_it;
+    yacxml_child_map_iterator_init(&ch_it, elem->children);
+    while ((ch_item = yacxml_child_map_iterator_next(&ch_it)) != NULL) {
         yacxml_serialize_to_file(ch_item->value, file, depth + 1);
     }
     for (int i = 0; i < depth - 1; i++) fputc('\t', file);
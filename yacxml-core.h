@@ -18,12 +18,16 @@ typedef struct {
     YacXMLAttributeMap *attributes;
 } YacXMLElement;
 
-YacXMLAttributeMapIterator *yacxml_attribute_map_iterator_new(YacXMLAttributeMap *attrs);
-YacXMLChildMapIterator *yacxml_child_map_iterator_new(YacXMLChildMap *chs);
+void yacxml_attribute_map_iterator_init(YacXMLAttributeMapIterator *it, YacXMLAttributeMap *attrs);
+void yacxml_child_map_iterator_init(YacXMLChildMapIterator *it, YacXMLChildMap *chs);
 YacXMLAttributeMapItem *yacxml_attribute_map_iterator_next(YacXMLAttributeMapIterator *it);
 YacXMLChildMapItem *yacxml_child_map_iterator_next(YacXMLChildMapIterator *it);
 
+// Elements made or parsed with an allocator take their names, texts, maps and
+// children from it, and attribute values passed to
+// yacxml_element_add_attribute must come from it too
 YacXMLElement *yacxml_element_new();
+YacXMLElement *yacxml_element_new_with(const YacDocAllocator *allocator);
 void yacxml_element_free(YacXMLElement *elem);
 char *yacxml_element_get_name(YacXMLElement *elem);
 void yacxml_element_set_name(YacXMLElement *elem, const char *name);
@@ -34,7 +38,20 @@ void yacxml_element_add_attribute(YacXMLElement *elem, const char *key, char *va
 YacXMLElement *yacxml_element_get_child(YacXMLElement *elem, const char *key);
 void yacxml_element_add_child(YacXMLElement *elem, const char *key, YacXMLElement *value);
 
+// Parser context owning the scratch space a parse reads names, attributes and
+// texts into, which grows as long as they need. Contexts share nothing, so
+// threads can parse at the same time with one each, and a context can be
+// reused for file after file without allocating its scratch space again.
+// yacxml_parse and yacxml_parse_with use a context of their own per call.
+// All of them return NULL when the file cannot be opened
+typedef struct YacXMLParser YacXMLParser;
+
 YacXMLElement *yacxml_parse(const char *filepath);
+YacXMLElement *yacxml_parse_with(const char *filepath, const YacDocAllocator *allocator);
+YacXMLParser *yacxml_parser_new();
+YacXMLParser *yacxml_parser_new_with(const YacDocAllocator *allocator);
+YacXMLElement *yacxml_parser_parse(YacXMLParser *parser, const char *filepath);
+void yacxml_parser_free(YacXMLParser *parser);
 void yacxml_serialize(YacXMLElement *elem, const char *filepath);
 
 #endif